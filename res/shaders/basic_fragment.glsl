@@ -2,9 +2,13 @@
 out vec4 color;
 
 in vec2 v_texCoords;
+flat in vec2 v_tileCorner;
+flat in int v_tiled;
 
 uniform sampler2D u_texture;
 
 void main() {
-    color = texture(u_texture, v_texCoords);
+    // tiled quads wrap their tex coords around inside a single 16x16 tile of the texture sheet
+    vec2 texCoords = v_tiled == 1 ? v_tileCorner + fract(v_texCoords) : v_texCoords;
+    color = texture(u_texture, texCoords / 16.0f);
 }
@@ -2,20 +2,48 @@
 layout(location = 0) in uint a_data;
 
 out vec2 v_texCoords;
+flat out vec2 v_tileCorner;
+flat out int v_tiled;
 
-uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
+// shared by every chunk and updated once per frame
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+};
+
+// The position in the world of the chunk each page of the vertex arena belongs to. Every
+// chunk's meshes share one vertex buffer, split into pages of PAGE_VERTICES vertices (the
+// same as VertexArena::PAGE_VERTICES), and gl_VertexID is the vertex's index in that buffer.
+uniform samplerBuffer u_pageOffsets;
+const int PAGE_VERTICES = 256;
 
 void main() {
     // retrieve the x, y, and z positions from their place in the data
     float xPos = float((a_data >> 23u) & 0x1Fu);
     float yPos = float((a_data >> 15u) & 0xFFu);
     float zPos = float((a_data >> 10u) & 0x1Fu);
-    gl_Position = u_projection * u_view * u_model * vec4(xPos, yPos, zPos, 1.0f);
+    vec3 chunkOffset = texelFetch(u_pageOffsets, gl_VertexID / PAGE_VERTICES).xyz;
+    gl_Position = u_projection * u_view * vec4(chunkOffset + vec3(xPos, yPos, zPos), 1.0f);
 
     // retrieve the tex coords from their place in the data
     float xTex = float((a_data >> 5u) & 0x1Fu);
     float yTex = float(a_data & 0x1Fu);
-    v_texCoords = vec2(xTex / 16.0f, yTex / 16.0f);
+
+    // greedy quads (bit 31) store the bottom left corner of their texture tile instead of
+    // tex coords. The tile is repeated once per block by using the position on the face.
+    v_tiled = int(a_data >> 31u);
+    if (v_tiled == 1) {
+        switch ((a_data >> 28u) & 0x7u) {
+            case 0u: v_texCoords = vec2(-zPos, yPos); break; // right (+x)
+            case 1u: v_texCoords = vec2(zPos, yPos); break;  // left (-x)
+            case 2u: v_texCoords = vec2(xPos, -zPos); break; // top (+y)
+            case 3u: v_texCoords = vec2(xPos, zPos); break;  // bottom (-y)
+            case 4u: v_texCoords = vec2(xPos, yPos); break;  // front (+z)
+            default: v_texCoords = vec2(-xPos, yPos); break; // back (-z)
+        }
+        v_tileCorner = vec2(xTex, yTex);
+    } else {
+        v_texCoords = vec2(xTex, yTex);
+        v_tileCorner = vec2(0.0f);
+    }
 }
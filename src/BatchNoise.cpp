@@ -0,0 +1,580 @@
+#include "BatchNoise.h"
+
+#include <random>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BATCH_NOISE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+// only these functions use the instructions, the rest of the program runs on any x86 CPU
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// the simplex skew factors, rounded to float once from the exact values
+static constexpr double SQRT3 = 1.7320508075688772935274463415059;
+static constexpr float F2 = static_cast<float>(0.5 * (SQRT3 - 1.0));
+static constexpr float G2 = static_cast<float>((3.0 - SQRT3) / 6.0);
+static constexpr float F3 = 1.0f / 3.0f;
+static constexpr float G3 = 1.0f / 6.0f;
+
+// the gradients picked by m_perm12 (2D noise only uses x and y)
+alignas(32) static const float GRAD_X[12] = { 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0 };
+alignas(32) static const float GRAD_Y[12] = { 1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1 };
+alignas(32) static const float GRAD_Z[12] = { 0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1 };
+
+enum class InstructionSet {
+    SCALAR, SSE2, AVX2
+};
+
+static InstructionSet detectInstructionSet() {
+#ifdef BATCH_NOISE_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    // AVX2 also needs the OS to save the 256-bit registers
+    bool osSavesAVX = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = osSavesAVX && (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) {
+        return InstructionSet::AVX2;
+    }
+    if (sse2) {
+        return InstructionSet::SSE2;
+    }
+#endif
+    return InstructionSet::SCALAR;
+}
+
+static InstructionSet getSupportedInstructionSet() {
+    static const InstructionSet instructionSet = detectInstructionSet();
+    return instructionSet;
+}
+
+// FastNoise's FastFloor, which also takes one off negative whole numbers
+static int fastFloor(float f) {
+    return f >= 0 ? static_cast<int>(f) : static_cast<int>(f) - 1;
+}
+
+BatchNoise::BatchNoise(int seed, float frequency, int octaves, float lacunarity, float gain)
+    : m_frequency{ frequency }, m_octaves{ octaves }, m_lacunarity{ lacunarity }, m_gain{ gain } {
+    // The same shuffle as FastNoise::SetSeed. k can be 256, which swaps in the copy of
+    // perm[0] (and writes into the copy half), so this has to be done on the whole table.
+    std::mt19937 generator(seed);
+    unsigned char perm[512] = {};
+    unsigned char perm12[512] = {};
+    for (int i = 0; i < 256; ++i) {
+        perm[i] = static_cast<unsigned char>(i);
+    }
+    for (int j = 0; j < 256; ++j) {
+        std::uniform_int_distribution<> distribution(0, 256 - j);
+        int k = distribution(generator) + j;
+        unsigned char swapped = perm[j];
+        perm[j] = perm[j + 256] = perm[k];
+        perm[k] = swapped;
+        perm12[j] = perm12[j + 256] = perm[j] % 12;
+    }
+    std::copy(perm, perm + 512, m_perm);
+    std::copy(perm12, perm12 + 512, m_perm12);
+
+    // and FastNoise::CalculateFractalBounding
+    float amp = m_gain;
+    float ampFractal = 1.0f;
+    for (int i = 1; i < m_octaves; ++i) {
+        ampFractal += amp;
+        amp *= m_gain;
+    }
+    m_fractalBounding = 1.0f / ampFractal;
+}
+
+float BatchNoise::getSimplexFractal(float x, float y) const {
+    x *= m_frequency;
+    y *= m_frequency;
+    float sum = singleSimplex(m_perm[0], x, y);
+    float amp = 1;
+    for (int octave = 1; octave < m_octaves; ++octave) {
+        x *= m_lacunarity;
+        y *= m_lacunarity;
+        amp *= m_gain;
+        sum += singleSimplex(m_perm[octave], x, y) * amp;
+    }
+    return sum * m_fractalBounding;
+}
+
+void BatchNoise::getSimplexFractalGrid(float startX, float startY, int sizeX, int sizeY, float* out) const {
+    // the points go through in batches that fit on the stack
+    constexpr int BATCH_SIZE = 256;
+    float x[BATCH_SIZE], y[BATCH_SIZE];
+    const int count = sizeX * sizeY;
+    for (int first = 0; first < count; first += BATCH_SIZE) {
+        int batchSize = std::min(BATCH_SIZE, count - first);
+        for (int i = 0; i < batchSize; ++i) {
+            x[i] = static_cast<float>((first + i) % sizeX) + startX;
+            y[i] = static_cast<float>((first + i) / sizeX) + startY;
+        }
+        getSimplexFractal(x, y, batchSize, out + first);
+    }
+}
+
+void BatchNoise::getSimplexFractal(const float* x, const float* y, int count, float* out) const {
+    switch (getSupportedInstructionSet()) {
+#ifdef BATCH_NOISE_X86
+    case InstructionSet::AVX2:
+        simplexFractalAVX2(x, y, count, out);
+        return;
+    case InstructionSet::SSE2:
+        simplexFractalSSE2(x, y, count, out);
+        return;
+#endif
+    default:
+        for (int i = 0; i < count; ++i) {
+            out[i] = getSimplexFractal(x[i], y[i]);
+        }
+    }
+}
+
+float BatchNoise::getSimplexFractal(float x, float y, float z) const {
+    x *= m_frequency;
+    y *= m_frequency;
+    z *= m_frequency;
+    float sum = singleSimplex(m_perm[0], x, y, z);
+    float amp = 1;
+    for (int octave = 1; octave < m_octaves; ++octave) {
+        x *= m_lacunarity;
+        y *= m_lacunarity;
+        z *= m_lacunarity;
+        amp *= m_gain;
+        sum += singleSimplex(m_perm[octave], x, y, z) * amp;
+    }
+    return sum * m_fractalBounding;
+}
+
+void BatchNoise::getSimplexFractal(const float* x, const float* y, const float* z, int count, float* out) const {
+    switch (getSupportedInstructionSet()) {
+#ifdef BATCH_NOISE_X86
+    case InstructionSet::AVX2:
+        simplexFractalAVX2(x, y, z, count, out);
+        return;
+    case InstructionSet::SSE2:
+        simplexFractalSSE2(x, y, z, count, out);
+        return;
+#endif
+    default:
+        for (int i = 0; i < count; ++i) {
+            out[i] = getSimplexFractal(x[i], y[i], z[i]);
+        }
+    }
+}
+
+const char* BatchNoise::getInstructionSet() {
+    switch (getSupportedInstructionSet()) {
+    case InstructionSet::AVX2:
+        return "AVX2";
+    case InstructionSet::SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+float BatchNoise::singleSimplex(int offset, float x, float y) const {
+    float t = (x + y) * F2;
+    int i = fastFloor(x + t);
+    int j = fastFloor(y + t);
+
+    t = (i + j) * G2;
+    float x0 = x - (i - t);
+    float y0 = y - (j - t);
+
+    int i1 = x0 > y0 ? 1 : 0;
+    int j1 = 1 - i1;
+    float x1 = x0 - static_cast<float>(i1) + G2;
+    float y1 = y0 - static_cast<float>(j1) + G2;
+    float x2 = x0 - 1 + 2 * G2;
+    float y2 = y0 - 1 + 2 * G2;
+
+    // the contribution of each corner of the simplex
+    const int cornerX[3] = { i, i + i1, i + 1 };
+    const int cornerY[3] = { j, j + j1, j + 1 };
+    const float offsetX[3] = { x0, x1, x2 };
+    const float offsetY[3] = { y0, y1, y2 };
+    float n[3];
+    for (int corner = 0; corner < 3; ++corner) {
+        t = 0.5f - offsetX[corner] * offsetX[corner] - offsetY[corner] * offsetY[corner];
+        if (t < 0) {
+            n[corner] = 0;
+        } else {
+            int gradient = m_perm12[(cornerX[corner] & 0xff) + m_perm[(cornerY[corner] & 0xff) + offset]];
+            t *= t;
+            n[corner] = t * t * (offsetX[corner] * GRAD_X[gradient] + offsetY[corner] * GRAD_Y[gradient]);
+        }
+    }
+    return 70 * (n[0] + n[1] + n[2]);
+}
+
+float BatchNoise::singleSimplex(int offset, float x, float y, float z) const {
+    float t = (x + y + z) * F3;
+    int i = fastFloor(x + t);
+    int j = fastFloor(y + t);
+    int k = fastFloor(z + t);
+
+    t = (i + j + k) * G3;
+    float x0 = x - (i - t);
+    float y0 = y - (j - t);
+    float z0 = z - (k - t);
+
+    // the second and third corners step along the axes in order of the largest offset
+    bool xy = x0 >= y0, yz = y0 >= z0, xz = x0 >= z0;
+    int i1 = xy && xz ? 1 : 0, j1 = !xy && yz ? 1 : 0, k1 = !xz && !yz ? 1 : 0;
+    int i2 = xy || xz ? 1 : 0, j2 = !xy || yz ? 1 : 0, k2 = !(xz && yz) ? 1 : 0;
+
+    const int cornerX[4] = { i, i + i1, i + i2, i + 1 };
+    const int cornerY[4] = { j, j + j1, j + j2, j + 1 };
+    const int cornerZ[4] = { k, k + k1, k + k2, k + 1 };
+    const float offsetX[4] = { x0, x0 - i1 + G3, x0 - i2 + 2 * G3, x0 - 1 + 3 * G3 };
+    const float offsetY[4] = { y0, y0 - j1 + G3, y0 - j2 + 2 * G3, y0 - 1 + 3 * G3 };
+    const float offsetZ[4] = { z0, z0 - k1 + G3, z0 - k2 + 2 * G3, z0 - 1 + 3 * G3 };
+    float n[4];
+    for (int corner = 0; corner < 4; ++corner) {
+        t = 0.6f - offsetX[corner] * offsetX[corner] - offsetY[corner] * offsetY[corner] - offsetZ[corner] * offsetZ[corner];
+        if (t < 0) {
+            n[corner] = 0;
+        } else {
+            int hash = m_perm[(cornerY[corner] & 0xff) + m_perm[(cornerZ[corner] & 0xff) + offset]];
+            int gradient = m_perm12[(cornerX[corner] & 0xff) + hash];
+            t *= t;
+            n[corner] = t * t * (offsetX[corner] * GRAD_X[gradient] + offsetY[corner] * GRAD_Y[gradient] + offsetZ[corner] * GRAD_Z[gradient]);
+        }
+    }
+    return 32 * (n[0] + n[1] + n[2] + n[3]);
+}
+
+#ifdef BATCH_NOISE_X86
+
+// The vector versions do exactly what singleSimplex does, a lane per point. Every corner is
+// computed and the ones outside the simplex (t < 0) are zeroed afterwards.
+
+TARGET_SSE2 static inline __m128i floorSSE2(__m128 v) {
+    // the comparison is all ones (-1) in the lanes to take one off
+    return _mm_add_epi32(_mm_cvttps_epi32(v), _mm_castps_si128(_mm_cmplt_ps(v, _mm_setzero_ps())));
+}
+
+TARGET_SSE2 static inline __m128 cornerSSE2(const int* perm, const int* perm12, int offset, __m128i i, __m128i j, __m128 x, __m128 y) {
+    // SSE2 has no gathers, so the gradients are looked up a lane at a time
+    alignas(16) int cornerX[4], cornerY[4];
+    alignas(16) float gradX[4], gradY[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(cornerX), i);
+    _mm_store_si128(reinterpret_cast<__m128i*>(cornerY), j);
+    for (int lane = 0; lane < 4; ++lane) {
+        int gradient = perm12[(cornerX[lane] & 0xff) + perm[(cornerY[lane] & 0xff) + offset]];
+        gradX[lane] = GRAD_X[gradient];
+        gradY[lane] = GRAD_Y[gradient];
+    }
+    __m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+    __m128 outside = _mm_cmplt_ps(t, _mm_setzero_ps());
+    t = _mm_mul_ps(t, t);
+    __m128 gradient = _mm_add_ps(_mm_mul_ps(x, _mm_load_ps(gradX)), _mm_mul_ps(y, _mm_load_ps(gradY)));
+    return _mm_andnot_ps(outside, _mm_mul_ps(_mm_mul_ps(t, t), gradient));
+}
+
+TARGET_SSE2 static inline __m128 simplexSSE2(const int* perm, const int* perm12, int offset, __m128 x, __m128 y) {
+    __m128 t = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(F2));
+    __m128i i = floorSSE2(_mm_add_ps(x, t));
+    __m128i j = floorSSE2(_mm_add_ps(y, t));
+
+    t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(i, j)), _mm_set1_ps(G2));
+    __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+    __m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+
+    __m128 stepX = _mm_cmpgt_ps(x0, y0); // i1 = 1, j1 = 0 in these lanes
+    __m128i i1 = _mm_srli_epi32(_mm_castps_si128(stepX), 31);
+    __m128i j1 = _mm_sub_epi32(_mm_set1_epi32(1), i1);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(stepX, one)), _mm_set1_ps(G2));
+    __m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_andnot_ps(stepX, one)), _mm_set1_ps(G2));
+    __m128 x2 = _mm_add_ps(_mm_sub_ps(x0, one), _mm_set1_ps(2 * G2));
+    __m128 y2 = _mm_add_ps(_mm_sub_ps(y0, one), _mm_set1_ps(2 * G2));
+
+    const __m128i oneInt = _mm_set1_epi32(1);
+    __m128 n0 = cornerSSE2(perm, perm12, offset, i, j, x0, y0);
+    __m128 n1 = cornerSSE2(perm, perm12, offset, _mm_add_epi32(i, i1), _mm_add_epi32(j, j1), x1, y1);
+    __m128 n2 = cornerSSE2(perm, perm12, offset, _mm_add_epi32(i, oneInt), _mm_add_epi32(j, oneInt), x2, y2);
+    return _mm_mul_ps(_mm_set1_ps(70.0f), _mm_add_ps(_mm_add_ps(n0, n1), n2));
+}
+
+TARGET_SSE2 void BatchNoise::simplexFractalSSE2(const float* xs, const float* ys, int count, float* out) const {
+    for (int first = 0; first < count; first += 4) {
+        // a partial batch at the end is padded with copies of its last point
+        int lanes = std::min(4, count - first);
+        alignas(16) float batchX[4], batchY[4], batchOut[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            batchX[lane] = xs[first + std::min(lane, lanes - 1)];
+            batchY[lane] = ys[first + std::min(lane, lanes - 1)];
+        }
+        __m128 x = _mm_mul_ps(_mm_load_ps(batchX), _mm_set1_ps(m_frequency));
+        __m128 y = _mm_mul_ps(_mm_load_ps(batchY), _mm_set1_ps(m_frequency));
+        __m128 sum = simplexSSE2(m_perm, m_perm12, m_perm[0], x, y);
+        float amp = 1;
+        for (int octave = 1; octave < m_octaves; ++octave) {
+            x = _mm_mul_ps(x, _mm_set1_ps(m_lacunarity));
+            y = _mm_mul_ps(y, _mm_set1_ps(m_lacunarity));
+            amp *= m_gain;
+            sum = _mm_add_ps(sum, _mm_mul_ps(simplexSSE2(m_perm, m_perm12, m_perm[octave], x, y), _mm_set1_ps(amp)));
+        }
+        _mm_store_ps(batchOut, _mm_mul_ps(sum, _mm_set1_ps(m_fractalBounding)));
+        std::copy(batchOut, batchOut + lanes, out + first);
+    }
+}
+
+TARGET_SSE2 static inline __m128 corner3DSSE2(const int* perm, const int* perm12, int offset, __m128i i, __m128i j, __m128i k,
+    __m128 x, __m128 y, __m128 z) {
+    alignas(16) int cornerX[4], cornerY[4], cornerZ[4];
+    alignas(16) float gradX[4], gradY[4], gradZ[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(cornerX), i);
+    _mm_store_si128(reinterpret_cast<__m128i*>(cornerY), j);
+    _mm_store_si128(reinterpret_cast<__m128i*>(cornerZ), k);
+    for (int lane = 0; lane < 4; ++lane) {
+        int hash = perm[(cornerY[lane] & 0xff) + perm[(cornerZ[lane] & 0xff) + offset]];
+        int gradient = perm12[(cornerX[lane] & 0xff) + hash];
+        gradX[lane] = GRAD_X[gradient];
+        gradY[lane] = GRAD_Y[gradient];
+        gradZ[lane] = GRAD_Z[gradient];
+    }
+    __m128 t = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.6f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    __m128 outside = _mm_cmplt_ps(t, _mm_setzero_ps());
+    t = _mm_mul_ps(t, t);
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_load_ps(gradX)), _mm_mul_ps(y, _mm_load_ps(gradY))), _mm_mul_ps(z, _mm_load_ps(gradZ)));
+    return _mm_andnot_ps(outside, _mm_mul_ps(_mm_mul_ps(t, t), dot));
+}
+
+TARGET_SSE2 static inline __m128 simplex3DSSE2(const int* perm, const int* perm12, int offset, __m128 x, __m128 y, __m128 z) {
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(x, y), z), _mm_set1_ps(F3));
+    __m128i i = floorSSE2(_mm_add_ps(x, t));
+    __m128i j = floorSSE2(_mm_add_ps(y, t));
+    __m128i k = floorSSE2(_mm_add_ps(z, t));
+
+    t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(i, j), k)), _mm_set1_ps(G3));
+    __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+    __m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+    __m128 z0 = _mm_sub_ps(z, _mm_sub_ps(_mm_cvtepi32_ps(k), t));
+
+    // the same steps as singleSimplex, as all ones masks
+    __m128 xy = _mm_cmpge_ps(x0, y0), yz = _mm_cmpge_ps(y0, z0), xz = _mm_cmpge_ps(x0, z0);
+    __m128 i1 = _mm_and_ps(xy, xz), j1 = _mm_andnot_ps(xy, yz), k1 = _mm_andnot_ps(xz, _mm_andnot_ps(yz, _mm_castsi128_ps(_mm_set1_epi32(-1))));
+    __m128 i2 = _mm_or_ps(xy, xz), j2 = _mm_or_ps(_mm_andnot_ps(xy, _mm_castsi128_ps(_mm_set1_epi32(-1))), yz);
+    __m128 k2 = _mm_andnot_ps(_mm_and_ps(xz, yz), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i1, one)), _mm_set1_ps(G3));
+    __m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j1, one)), _mm_set1_ps(G3));
+    __m128 z1 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k1, one)), _mm_set1_ps(G3));
+    __m128 x2 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i2, one)), _mm_set1_ps(2 * G3));
+    __m128 y2 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j2, one)), _mm_set1_ps(2 * G3));
+    __m128 z2 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k2, one)), _mm_set1_ps(2 * G3));
+    __m128 x3 = _mm_add_ps(_mm_sub_ps(x0, one), _mm_set1_ps(3 * G3));
+    __m128 y3 = _mm_add_ps(_mm_sub_ps(y0, one), _mm_set1_ps(3 * G3));
+    __m128 z3 = _mm_add_ps(_mm_sub_ps(z0, one), _mm_set1_ps(3 * G3));
+
+    // an all ones mask is -1, so subtracting it steps the corner by one
+    __m128i oneInt = _mm_set1_epi32(1);
+    __m128 n0 = corner3DSSE2(perm, perm12, offset, i, j, k, x0, y0, z0);
+    __m128 n1 = corner3DSSE2(perm, perm12, offset, _mm_sub_epi32(i, _mm_castps_si128(i1)), _mm_sub_epi32(j, _mm_castps_si128(j1)),
+        _mm_sub_epi32(k, _mm_castps_si128(k1)), x1, y1, z1);
+    __m128 n2 = corner3DSSE2(perm, perm12, offset, _mm_sub_epi32(i, _mm_castps_si128(i2)), _mm_sub_epi32(j, _mm_castps_si128(j2)),
+        _mm_sub_epi32(k, _mm_castps_si128(k2)), x2, y2, z2);
+    __m128 n3 = corner3DSSE2(perm, perm12, offset, _mm_add_epi32(i, oneInt), _mm_add_epi32(j, oneInt), _mm_add_epi32(k, oneInt), x3, y3, z3);
+    return _mm_mul_ps(_mm_set1_ps(32.0f), _mm_add_ps(_mm_add_ps(_mm_add_ps(n0, n1), n2), n3));
+}
+
+TARGET_SSE2 void BatchNoise::simplexFractalSSE2(const float* xs, const float* ys, const float* zs, int count, float* out) const {
+    for (int first = 0; first < count; first += 4) {
+        int lanes = std::min(4, count - first);
+        alignas(16) float batchX[4], batchY[4], batchZ[4], batchOut[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            batchX[lane] = xs[first + std::min(lane, lanes - 1)];
+            batchY[lane] = ys[first + std::min(lane, lanes - 1)];
+            batchZ[lane] = zs[first + std::min(lane, lanes - 1)];
+        }
+        __m128 x = _mm_mul_ps(_mm_load_ps(batchX), _mm_set1_ps(m_frequency));
+        __m128 y = _mm_mul_ps(_mm_load_ps(batchY), _mm_set1_ps(m_frequency));
+        __m128 z = _mm_mul_ps(_mm_load_ps(batchZ), _mm_set1_ps(m_frequency));
+        __m128 sum = simplex3DSSE2(m_perm, m_perm12, m_perm[0], x, y, z);
+        float amp = 1;
+        for (int octave = 1; octave < m_octaves; ++octave) {
+            x = _mm_mul_ps(x, _mm_set1_ps(m_lacunarity));
+            y = _mm_mul_ps(y, _mm_set1_ps(m_lacunarity));
+            z = _mm_mul_ps(z, _mm_set1_ps(m_lacunarity));
+            amp *= m_gain;
+            sum = _mm_add_ps(sum, _mm_mul_ps(simplex3DSSE2(m_perm, m_perm12, m_perm[octave], x, y, z), _mm_set1_ps(amp)));
+        }
+        _mm_store_ps(batchOut, _mm_mul_ps(sum, _mm_set1_ps(m_fractalBounding)));
+        std::copy(batchOut, batchOut + lanes, out + first);
+    }
+}
+
+TARGET_AVX2 static inline __m256i floorAVX2(__m256 v) {
+    return _mm256_add_epi32(_mm256_cvttps_epi32(v), _mm256_castps_si256(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ)));
+}
+
+TARGET_AVX2 static inline __m256 cornerAVX2(const int* perm, const int* perm12, __m256i offset, __m256i i, __m256i j, __m256 x, __m256 y) {
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i hash = _mm256_i32gather_epi32(perm, _mm256_add_epi32(_mm256_and_si256(j, mask), offset), 4);
+    __m256i gradient = _mm256_i32gather_epi32(perm12, _mm256_add_epi32(_mm256_and_si256(i, mask), hash), 4);
+    __m256 gradX = _mm256_i32gather_ps(GRAD_X, gradient, 4);
+    __m256 gradY = _mm256_i32gather_ps(GRAD_Y, gradient, 4);
+
+    __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y));
+    __m256 outside = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_LT_OQ);
+    t = _mm256_mul_ps(t, t);
+    __m256 dot = _mm256_add_ps(_mm256_mul_ps(x, gradX), _mm256_mul_ps(y, gradY));
+    return _mm256_andnot_ps(outside, _mm256_mul_ps(_mm256_mul_ps(t, t), dot));
+}
+
+TARGET_AVX2 static inline __m256 simplexAVX2(const int* perm, const int* perm12, int offset, __m256 x, __m256 y) {
+    __m256 t = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(F2));
+    __m256i i = floorAVX2(_mm256_add_ps(x, t));
+    __m256i j = floorAVX2(_mm256_add_ps(y, t));
+
+    t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(i, j)), _mm256_set1_ps(G2));
+    __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+
+    __m256 stepX = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+    __m256i i1 = _mm256_srli_epi32(_mm256_castps_si256(stepX), 31);
+    __m256i j1 = _mm256_sub_epi32(_mm256_set1_epi32(1), i1);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(stepX, one)), _mm256_set1_ps(G2));
+    __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_andnot_ps(stepX, one)), _mm256_set1_ps(G2));
+    __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, one), _mm256_set1_ps(2 * G2));
+    __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, one), _mm256_set1_ps(2 * G2));
+
+    const __m256i offsets = _mm256_set1_epi32(offset);
+    const __m256i oneInt = _mm256_set1_epi32(1);
+    __m256 n0 = cornerAVX2(perm, perm12, offsets, i, j, x0, y0);
+    __m256 n1 = cornerAVX2(perm, perm12, offsets, _mm256_add_epi32(i, i1), _mm256_add_epi32(j, j1), x1, y1);
+    __m256 n2 = cornerAVX2(perm, perm12, offsets, _mm256_add_epi32(i, oneInt), _mm256_add_epi32(j, oneInt), x2, y2);
+    return _mm256_mul_ps(_mm256_set1_ps(70.0f), _mm256_add_ps(_mm256_add_ps(n0, n1), n2));
+}
+
+TARGET_AVX2 void BatchNoise::simplexFractalAVX2(const float* xs, const float* ys, int count, float* out) const {
+    for (int first = 0; first < count; first += 8) {
+        int lanes = std::min(8, count - first);
+        alignas(32) float batchX[8], batchY[8], batchOut[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            batchX[lane] = xs[first + std::min(lane, lanes - 1)];
+            batchY[lane] = ys[first + std::min(lane, lanes - 1)];
+        }
+        __m256 x = _mm256_mul_ps(_mm256_load_ps(batchX), _mm256_set1_ps(m_frequency));
+        __m256 y = _mm256_mul_ps(_mm256_load_ps(batchY), _mm256_set1_ps(m_frequency));
+        __m256 sum = simplexAVX2(m_perm, m_perm12, m_perm[0], x, y);
+        float amp = 1;
+        for (int octave = 1; octave < m_octaves; ++octave) {
+            x = _mm256_mul_ps(x, _mm256_set1_ps(m_lacunarity));
+            y = _mm256_mul_ps(y, _mm256_set1_ps(m_lacunarity));
+            amp *= m_gain;
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(simplexAVX2(m_perm, m_perm12, m_perm[octave], x, y), _mm256_set1_ps(amp)));
+        }
+        _mm256_store_ps(batchOut, _mm256_mul_ps(sum, _mm256_set1_ps(m_fractalBounding)));
+        std::copy(batchOut, batchOut + lanes, out + first);
+    }
+}
+
+TARGET_AVX2 static inline __m256 corner3DAVX2(const int* perm, const int* perm12, __m256i offset, __m256i i, __m256i j, __m256i k,
+    __m256 x, __m256 y, __m256 z) {
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i hash = _mm256_i32gather_epi32(perm, _mm256_add_epi32(_mm256_and_si256(k, mask), offset), 4);
+    hash = _mm256_i32gather_epi32(perm, _mm256_add_epi32(_mm256_and_si256(j, mask), hash), 4);
+    __m256i gradient = _mm256_i32gather_epi32(perm12, _mm256_add_epi32(_mm256_and_si256(i, mask), hash), 4);
+    __m256 gradX = _mm256_i32gather_ps(GRAD_X, gradient, 4);
+    __m256 gradY = _mm256_i32gather_ps(GRAD_Y, gradient, 4);
+    __m256 gradZ = _mm256_i32gather_ps(GRAD_Z, gradient, 4);
+
+    __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.6f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+    __m256 outside = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_LT_OQ);
+    t = _mm256_mul_ps(t, t);
+    __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, gradX), _mm256_mul_ps(y, gradY)), _mm256_mul_ps(z, gradZ));
+    return _mm256_andnot_ps(outside, _mm256_mul_ps(_mm256_mul_ps(t, t), dot));
+}
+
+TARGET_AVX2 static inline __m256 simplex3DAVX2(const int* perm, const int* perm12, int offset, __m256 x, __m256 y, __m256 z) {
+    __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), _mm256_set1_ps(F3));
+    __m256i i = floorAVX2(_mm256_add_ps(x, t));
+    __m256i j = floorAVX2(_mm256_add_ps(y, t));
+    __m256i k = floorAVX2(_mm256_add_ps(z, t));
+
+    t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(i, j), k)), _mm256_set1_ps(G3));
+    __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+    __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(_mm256_cvtepi32_ps(k), t));
+
+    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256 xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ), yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ), xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+    __m256 i1 = _mm256_and_ps(xy, xz), j1 = _mm256_andnot_ps(xy, yz), k1 = _mm256_andnot_ps(xz, _mm256_andnot_ps(yz, all));
+    __m256 i2 = _mm256_or_ps(xy, xz), j2 = _mm256_or_ps(_mm256_andnot_ps(xy, all), yz), k2 = _mm256_andnot_ps(_mm256_and_ps(xz, yz), all);
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(i1, one)), _mm256_set1_ps(G3));
+    __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_and_ps(j1, one)), _mm256_set1_ps(G3));
+    __m256 z1 = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_and_ps(k1, one)), _mm256_set1_ps(G3));
+    __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(i2, one)), _mm256_set1_ps(2 * G3));
+    __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_and_ps(j2, one)), _mm256_set1_ps(2 * G3));
+    __m256 z2 = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_and_ps(k2, one)), _mm256_set1_ps(2 * G3));
+    __m256 x3 = _mm256_add_ps(_mm256_sub_ps(x0, one), _mm256_set1_ps(3 * G3));
+    __m256 y3 = _mm256_add_ps(_mm256_sub_ps(y0, one), _mm256_set1_ps(3 * G3));
+    __m256 z3 = _mm256_add_ps(_mm256_sub_ps(z0, one), _mm256_set1_ps(3 * G3));
+
+    const __m256i offsets = _mm256_set1_epi32(offset);
+    const __m256i oneInt = _mm256_set1_epi32(1);
+    __m256 n0 = corner3DAVX2(perm, perm12, offsets, i, j, k, x0, y0, z0);
+    __m256 n1 = corner3DAVX2(perm, perm12, offsets, _mm256_sub_epi32(i, _mm256_castps_si256(i1)), _mm256_sub_epi32(j, _mm256_castps_si256(j1)),
+        _mm256_sub_epi32(k, _mm256_castps_si256(k1)), x1, y1, z1);
+    __m256 n2 = corner3DAVX2(perm, perm12, offsets, _mm256_sub_epi32(i, _mm256_castps_si256(i2)), _mm256_sub_epi32(j, _mm256_castps_si256(j2)),
+        _mm256_sub_epi32(k, _mm256_castps_si256(k2)), x2, y2, z2);
+    __m256 n3 = corner3DAVX2(perm, perm12, offsets, _mm256_add_epi32(i, oneInt), _mm256_add_epi32(j, oneInt), _mm256_add_epi32(k, oneInt), x3, y3, z3);
+    return _mm256_mul_ps(_mm256_set1_ps(32.0f), _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2), n3));
+}
+
+TARGET_AVX2 void BatchNoise::simplexFractalAVX2(const float* xs, const float* ys, const float* zs, int count, float* out) const {
+    for (int first = 0; first < count; first += 8) {
+        int lanes = std::min(8, count - first);
+        alignas(32) float batchX[8], batchY[8], batchZ[8], batchOut[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            batchX[lane] = xs[first + std::min(lane, lanes - 1)];
+            batchY[lane] = ys[first + std::min(lane, lanes - 1)];
+            batchZ[lane] = zs[first + std::min(lane, lanes - 1)];
+        }
+        __m256 x = _mm256_mul_ps(_mm256_load_ps(batchX), _mm256_set1_ps(m_frequency));
+        __m256 y = _mm256_mul_ps(_mm256_load_ps(batchY), _mm256_set1_ps(m_frequency));
+        __m256 z = _mm256_mul_ps(_mm256_load_ps(batchZ), _mm256_set1_ps(m_frequency));
+        __m256 sum = simplex3DAVX2(m_perm, m_perm12, m_perm[0], x, y, z);
+        float amp = 1;
+        for (int octave = 1; octave < m_octaves; ++octave) {
+            x = _mm256_mul_ps(x, _mm256_set1_ps(m_lacunarity));
+            y = _mm256_mul_ps(y, _mm256_set1_ps(m_lacunarity));
+            z = _mm256_mul_ps(z, _mm256_set1_ps(m_lacunarity));
+            amp *= m_gain;
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(simplex3DAVX2(m_perm, m_perm12, m_perm[octave], x, y, z), _mm256_set1_ps(amp)));
+        }
+        _mm256_store_ps(batchOut, _mm256_mul_ps(sum, _mm256_set1_ps(m_fractalBounding)));
+        std::copy(batchOut, batchOut + lanes, out + first);
+    }
+}
+
+#endif
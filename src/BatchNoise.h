@@ -0,0 +1,45 @@
+#ifndef BATCH_NOISE_H_INCLUDED
+#define BATCH_NOISE_H_INCLUDED
+
+// FastNoise's 2D and 3D simplex fractal (FBM) noise, evaluated for many points at once with SSE2 or
+// AVX2 (whichever the CPU supports, picked when the program starts). It follows FastNoise's steps,
+// but in float, while this FastNoise is built with FN_USE_DOUBLES. So it is not the same noise:
+// for a FastNoise with the same settings, the values differ by up to about 3.4e-5 in 2D and 3.2e-4
+// in 3D, which moves the ground of a few columns in every ten thousand by a block.
+// Read only once constructed, so any number of threads can share one.
+class BatchNoise {
+    int m_perm[512];   // FastNoise's permutation table, as ints so AVX2 can gather from it
+    int m_perm12[512]; // m_perm % 12, the gradient of each hash
+    float m_frequency;
+    int m_octaves;
+    float m_lacunarity;
+    float m_gain;
+    float m_fractalBounding; // scales the sum of the octaves back to -1..1
+
+public:
+    // the defaults are FastNoise's
+    BatchNoise(int seed = 1337, float frequency = 0.01f, int octaves = 3, float lacunarity = 2.0f, float gain = 0.5f);
+
+    float getSimplexFractal(float x, float y) const;
+    // fills out[row * sizeX + column] with the noise at (startX + column, startY + row)
+    void getSimplexFractalGrid(float startX, float startY, int sizeX, int sizeY, float* out) const;
+    // fills out[i] with the noise at (x[i], y[i])
+    void getSimplexFractal(const float* x, const float* y, int count, float* out) const;
+
+    float getSimplexFractal(float x, float y, float z) const;
+    // fills out[i] with the noise at (x[i], y[i], z[i])
+    void getSimplexFractal(const float* x, const float* y, const float* z, int count, float* out) const;
+
+    // the instruction set used for the batches
+    static const char* getInstructionSet();
+
+private:
+    float singleSimplex(int offset, float x, float y) const;
+    void simplexFractalSSE2(const float* x, const float* y, int count, float* out) const;
+    void simplexFractalAVX2(const float* x, const float* y, int count, float* out) const;
+    float singleSimplex(int offset, float x, float y, float z) const;
+    void simplexFractalSSE2(const float* x, const float* y, const float* z, int count, float* out) const;
+    void simplexFractalAVX2(const float* x, const float* y, const float* z, int count, float* out) const;
+};
+
+#endif
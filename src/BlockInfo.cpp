@@ -1,6 +1,7 @@
 #include "BlockInfo.h"
 
 #include <iostream>
+#include <algorithm>
 
 namespace Block {
 
@@ -15,6 +16,18 @@ namespace Block {
         return nullptr;
     }
 
+    unsigned int getTextureTile(BlockType type, BlockFace face) {
+        // the bottom left corner of the face's texture in the texture sheet,
+        // packed the same way as the texX (bits 5-9) and texY (bits 0-4) vertex data
+        const unsigned int* data = getData(type, face);
+        unsigned int texX = 0x1F, texY = 0x1F;
+        for (unsigned int vertex = 0; vertex < VERTICES_PER_FACE; ++vertex) {
+            texX = std::min(texX, (data[vertex] >> 5) & 0x1F);
+            texY = std::min(texY, data[vertex] & 0x1F);
+        }
+        return (texX << 5) + texY;
+    }
+
     bool isTransparent(BlockType type) {
         return type == BlockType::AIR;
     }
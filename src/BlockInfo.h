@@ -4,7 +4,8 @@
 namespace Block {
 
     inline constexpr unsigned int FACES_PER_BLOCK = 6;
-    inline constexpr unsigned int VERTICES_PER_FACE = 6;
+    inline constexpr unsigned int VERTICES_PER_FACE = 4;
+    inline constexpr unsigned int INDICES_PER_FACE = 6;
     inline constexpr unsigned int VERTICES_PER_BLOCK = VERTICES_PER_FACE * FACES_PER_BLOCK;
     inline constexpr unsigned int UINTS_PER_VERTEX = 1;
     inline constexpr unsigned int UINTS_PER_FACE = VERTICES_PER_FACE * UINTS_PER_VERTEX;
@@ -28,6 +29,7 @@ namespace Block {
     };
 
     const unsigned int* getData(BlockType type, BlockFace face);
+    unsigned int getTextureTile(BlockType type, BlockFace face);
     bool isTransparent(BlockType type);
     
     inline constexpr unsigned int GRASS_BLOCK_DATA[] = {
@@ -35,44 +37,32 @@ namespace Block {
         0b00001'00000000'00001'00000'01111, // right (+x)
         0b00001'00000000'00000'00001'01111,
         0b00001'00000001'00000'00001'10000,
-        0b00001'00000001'00000'00001'10000,
         0b00001'00000001'00001'00000'10000,
-        0b00001'00000000'00001'00000'01111,
              
         0b00000'00000000'00000'00000'01111, // left (-x)
         0b00000'00000000'00001'00001'01111,
         0b00000'00000001'00001'00001'10000,
-        0b00000'00000001'00001'00001'10000,
         0b00000'00000001'00000'00000'10000,
-        0b00000'00000000'00000'00000'01111,
 
         0b00000'00000001'00001'00010'01111, // top (+y)
         0b00001'00000001'00001'00011'01111,
         0b00001'00000001'00000'00011'10000,
-        0b00001'00000001'00000'00011'10000,
         0b00000'00000001'00000'00010'10000,
-        0b00000'00000001'00001'00010'01111,
 
         0b00000'00000000'00000'00001'01111, // bottom (-y)
         0b00001'00000000'00000'00010'01111,
         0b00001'00000000'00001'00010'10000,
-        0b00001'00000000'00001'00010'10000,
         0b00000'00000000'00001'00001'10000,
-        0b00000'00000000'00000'00001'01111,
 
         0b00000'00000000'00001'00000'01111, // front (+z)
         0b00001'00000000'00001'00001'01111,
         0b00001'00000001'00001'00001'10000,
-        0b00001'00000001'00001'00001'10000,
         0b00000'00000001'00001'00000'10000,
-        0b00000'00000000'00001'00000'01111,
 
         0b00001'00000000'00000'00000'01111, // back (-z)
         0b00000'00000000'00000'00001'01111,
         0b00000'00000001'00000'00001'10000,
-        0b00000'00000001'00000'00001'10000,
         0b00001'00000001'00000'00000'10000,
-        0b00001'00000000'00000'00000'01111,
     };
 
     inline constexpr unsigned int DIRT_BLOCK_DATA[] = {
@@ -80,44 +70,32 @@ namespace Block {
         0b00001'00000000'00001'00001'01111, // right (+x)
         0b00001'00000000'00000'00010'01111,
         0b00001'00000001'00000'00010'10000,
-        0b00001'00000001'00000'00010'10000,
         0b00001'00000001'00001'00001'10000,
-        0b00001'00000000'00001'00001'01111,
 
         0b00000'00000000'00000'00001'01111, // left (-x)
         0b00000'00000000'00001'00010'01111,
         0b00000'00000001'00001'00010'10000,
-        0b00000'00000001'00001'00010'10000,
         0b00000'00000001'00000'00001'10000,
-        0b00000'00000000'00000'00001'01111,
 
         0b00000'00000001'00001'00001'01111, // top (+y)
         0b00001'00000001'00001'00010'01111,
         0b00001'00000001'00000'00010'10000,
-        0b00001'00000001'00000'00010'10000,
         0b00000'00000001'00000'00001'10000,
-        0b00000'00000001'00001'00001'01111,
 
         0b00000'00000000'00000'00001'01111, // bottom (-y)
         0b00001'00000000'00000'00010'01111,
         0b00001'00000000'00001'00010'10000,
-        0b00001'00000000'00001'00010'10000,
         0b00000'00000000'00001'00001'10000,
-        0b00000'00000000'00000'00001'01111,
 
         0b00000'00000000'00001'00001'01111, // front (+z)
         0b00001'00000000'00001'00010'01111,
         0b00001'00000001'00001'00010'10000,
-        0b00001'00000001'00001'00010'10000,
         0b00000'00000001'00001'00001'10000,
-        0b00000'00000000'00001'00001'01111,
 
         0b00001'00000000'00000'00001'01111, // back (-z)
         0b00000'00000000'00000'00010'01111,
         0b00000'00000001'00000'00010'10000,
-        0b00000'00000001'00000'00010'10000,
         0b00001'00000001'00000'00001'10000,
-        0b00001'00000000'00000'00001'01111,
     };
 
     inline constexpr unsigned int STONE_BLOCK_DATA[] = {
@@ -125,44 +103,32 @@ namespace Block {
         0b00001'00000000'00001'00011'01111, // right (+x)
         0b00001'00000000'00000'00100'01111,
         0b00001'00000001'00000'00100'10000,
-        0b00001'00000001'00000'00100'10000,
         0b00001'00000001'00001'00011'10000,
-        0b00001'00000000'00001'00011'01111,
 
         0b00000'00000000'00000'00011'01111, // left (-x)
         0b00000'00000000'00001'00100'01111,
         0b00000'00000001'00001'00100'10000,
-        0b00000'00000001'00001'00100'10000,
         0b00000'00000001'00000'00011'10000,
-        0b00000'00000000'00000'00011'01111,
 
         0b00000'00000001'00001'00011'01111, // top (+y)
         0b00001'00000001'00001'00100'01111,
         0b00001'00000001'00000'00100'10000,
-        0b00001'00000001'00000'00100'10000,
         0b00000'00000001'00000'00011'10000,
-        0b00000'00000001'00001'00011'01111,
 
         0b00000'00000000'00000'00011'01111, // bottom (-y)
         0b00001'00000000'00000'00100'01111,
         0b00001'00000000'00001'00100'10000,
-        0b00001'00000000'00001'00100'10000,
         0b00000'00000000'00001'00011'10000,
-        0b00000'00000000'00000'00011'01111,
 
         0b00000'00000000'00001'00011'01111, // front (+z)
         0b00001'00000000'00001'00100'01111,
         0b00001'00000001'00001'00100'10000,
-        0b00001'00000001'00001'00100'10000,
         0b00000'00000001'00001'00011'10000,
-        0b00000'00000000'00001'00011'01111,
 
         0b00001'00000000'00000'00011'01111, // back (-z)
         0b00000'00000000'00000'00100'01111,
         0b00000'00000001'00000'00100'10000,
-        0b00000'00000001'00000'00100'10000,
         0b00001'00000001'00000'00011'10000,
-        0b00001'00000000'00000'00011'01111,
     };
 
 }
@@ -0,0 +1,66 @@
+#ifndef BLOCK_LAYOUT_H_INCLUDED
+#define BLOCK_LAYOUT_H_INCLUDED
+
+// The orders the blocks of a SIZE_X * SIZE_Y * SIZE_Z box can be stored in, for picking the
+// one a chunk's sections use at compile time (see CHUNK_LAYOUT in Chunk.h). Each gives the
+// index of block (x, y, z) in the box. The axes are named from the slowest changing to the
+// fastest, so in XYZ the blocks next to each other in z are next to each other in memory.
+// Z_ROWS is true when every row of z is stored in order in one run, and can be read all at once.
+namespace BlockLayout {
+
+    template <int SIZE_X, int SIZE_Y, int SIZE_Z>
+    struct XYZ {
+        static constexpr const char* NAME = "XYZ";
+        static constexpr bool Z_ROWS = true;
+        static constexpr int index(int x, int y, int z) {
+            return (x * SIZE_Y + y) * SIZE_Z + z;
+        }
+    };
+
+    // y fastest, for walking up and down columns
+    template <int SIZE_X, int SIZE_Y, int SIZE_Z>
+    struct XZY {
+        static constexpr const char* NAME = "XZY";
+        static constexpr bool Z_ROWS = false;
+        static constexpr int index(int x, int y, int z) {
+            return (x * SIZE_Z + z) * SIZE_Y + y;
+        }
+    };
+
+    // whole horizontal layers one after another
+    template <int SIZE_X, int SIZE_Y, int SIZE_Z>
+    struct YZX {
+        static constexpr const char* NAME = "YZX";
+        static constexpr bool Z_ROWS = false;
+        static constexpr int index(int x, int y, int z) {
+            return (y * SIZE_Z + z) * SIZE_X + x;
+        }
+    };
+
+    // Z-order: the bits of x, y and z interleaved (z in the lowest), so every 2x2x2, 4x4x4, ...
+    // cube aligned to its size is stored in one run, and blocks near each other on any axis
+    // are usually near each other in memory
+    template <int SIZE_X, int SIZE_Y, int SIZE_Z>
+    struct Morton {
+        static_assert(SIZE_X == SIZE_Y && SIZE_Y == SIZE_Z && (SIZE_X & (SIZE_X - 1)) == 0 && SIZE_X <= 1024,
+            "Morton order needs a cube with a power of two side");
+        static constexpr const char* NAME = "Morton";
+        static constexpr bool Z_ROWS = false;
+        static constexpr int index(int x, int y, int z) {
+            return spread(x) << 2 | spread(y) << 1 | spread(z);
+        }
+
+    private:
+        // puts two zero bits between each of the bits of v (up to 10 bits)
+        static constexpr int spread(int v) {
+            unsigned int bits = static_cast<unsigned int>(v) & 0x3FF;
+            bits = (bits | bits << 16) & 0x030000FF;
+            bits = (bits | bits << 8) & 0x0300F00F;
+            bits = (bits | bits << 4) & 0x030C30C3;
+            bits = (bits | bits << 2) & 0x09249249;
+            return static_cast<int>(bits);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,231 @@
+#include "BlockStorage.h"
+#include "BlockInfo.h"
+
+#include <vector>
+#include <algorithm>
+
+// unsigned integers are stored 7 bits per byte, lowest first, with the top bit set on every byte but the last
+static void putVarint(std::vector<unsigned char>& data, unsigned long long value) {
+    for (; value >= 0x80; value >>= 7) {
+        data.push_back(static_cast<unsigned char>(value | 0x80));
+    }
+    data.push_back(static_cast<unsigned char>(value));
+}
+
+static bool getVarint(const unsigned char*& data, const unsigned char* end, unsigned long long& value) {
+    value = 0;
+    for (int shift = 0; data != end && shift < 64; shift += 7) {
+        unsigned char byte = *data++;
+        value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BlockStorage::BlockStorage(int size, Block::BlockType fill) {
+    reset(size, fill);
+}
+
+void BlockStorage::clear() {
+    reset(m_size);
+}
+
+void BlockStorage::reset(int size, Block::BlockType fill) {
+    m_size = size;
+    m_bitsPerIndex = 0;
+    std::fill(std::begin(m_paletteIndex), std::end(m_paletteIndex), NO_INDEX);
+    m_palette.assign(1, fill);
+    m_paletteIndex[static_cast<int>(fill)] = 0;
+    m_words.clear();
+}
+
+void BlockStorage::getRange(int index, int count, Block::BlockType* blocks) const {
+    // decode count blocks in a row, starting at index, walking through the words instead of looking each one up
+    if (m_bitsPerIndex == 0) {
+        std::fill_n(blocks, count, m_palette[0]);
+        return;
+    }
+    unsigned long long mask = (1ull << m_bitsPerIndex) - 1;
+    unsigned int bit = index * m_bitsPerIndex;
+    for (int i = 0; i < count; ++i, bit += m_bitsPerIndex) {
+        blocks[i] = m_palette[(m_words[bit / 64] >> (bit % 64)) & mask];
+    }
+}
+
+void BlockStorage::put(int index, Block::BlockType block) {
+    unsigned int paletteIndex = m_paletteIndex[static_cast<int>(block)];
+    if (paletteIndex == NO_INDEX) {
+        // Add the new type to the palette. The indices are only widened when they can't count
+        // up to the new entry (widen() also moves a uniform storage from 0 bits to 1 bit).
+        paletteIndex = static_cast<unsigned int>(m_palette.size());
+        m_palette.push_back(block);
+        m_paletteIndex[static_cast<int>(block)] = static_cast<unsigned char>(paletteIndex);
+        if (paletteIndex >= (1u << m_bitsPerIndex)) {
+            widen();
+        }
+    }
+    if (m_bitsPerIndex != 0) {
+        setIndex(index, paletteIndex);
+    }
+}
+
+void BlockStorage::assign(const Block::BlockType* blocks) {
+    // find the palette first, so the indices are packed once at their final width instead of
+    // being widened as each new type turns up
+    reset(m_size, blocks[0]);
+    for (int i = 1; i < m_size; ++i) {
+        if (m_paletteIndex[static_cast<int>(blocks[i])] == NO_INDEX) {
+            m_paletteIndex[static_cast<int>(blocks[i])] = static_cast<unsigned char>(m_palette.size());
+            m_palette.push_back(blocks[i]);
+        }
+    }
+    if (m_palette.size() == 1) {
+        return;
+    }
+    m_bitsPerIndex = 1;
+    while ((1u << m_bitsPerIndex) < m_palette.size()) {
+        m_bitsPerIndex *= 2;
+    }
+    const int indicesPerWord = 64 / m_bitsPerIndex;
+    m_words.resize((static_cast<std::size_t>(m_size) * m_bitsPerIndex + 63) / 64);
+    for (std::size_t word = 0; word < m_words.size(); ++word) {
+        unsigned long long bits = 0;
+        int first = static_cast<int>(word) * indicesPerWord;
+        int count = std::min(indicesPerWord, m_size - first);
+        for (int i = 0; i < count; ++i) {
+            bits |= static_cast<unsigned long long>(m_paletteIndex[static_cast<int>(blocks[first + i])]) << (i * m_bitsPerIndex);
+        }
+        m_words[word] = bits;
+    }
+}
+
+void BlockStorage::compact() {
+    // Types are never removed from the palette by put(), so after blocks are replaced it may hold
+    // types that are no longer used. Rebuild it from the blocks that are left, which also brings
+    // the storage back down to 0 bits if only one type is left.
+    if (m_bitsPerIndex == 0) {
+        return;
+    }
+    std::vector<Block::BlockType> blocks(m_size);
+    getRange(0, m_size, blocks.data());
+    assign(blocks.data());
+    m_words.shrink_to_fit();
+}
+
+bool BlockStorage::isUniform() const {
+    return m_bitsPerIndex == 0;
+}
+
+std::size_t BlockStorage::getMemoryUsage() const {
+    return sizeof(BlockStorage) + m_palette.capacity() * sizeof(Block::BlockType) + m_words.capacity() * sizeof(unsigned long long);
+}
+
+void BlockStorage::serialize(std::vector<unsigned char>& data) const {
+    data.push_back(static_cast<unsigned char>(m_palette.size()));
+    for (Block::BlockType block : m_palette) {
+        data.push_back(static_cast<unsigned char>(block));
+    }
+    if (m_bitsPerIndex == 0) {
+        return;
+    }
+    // Terrain leaves long stretches of identical words (all stone, all air), so each word is
+    // stored once with the number of times it repeats, as little endian bytes
+    data.push_back(static_cast<unsigned char>(m_bitsPerIndex));
+    for (std::size_t i = 0; i < m_words.size();) {
+        std::size_t run = 1;
+        while (i + run < m_words.size() && m_words[i + run] == m_words[i]) {
+            ++run;
+        }
+        putVarint(data, run);
+        for (int byte = 0; byte < 8; ++byte) {
+            data.push_back(static_cast<unsigned char>(m_words[i] >> (byte * 8)));
+        }
+        i += run;
+    }
+}
+
+bool BlockStorage::deserialize(const unsigned char*& data, const unsigned char* end) {
+    // invalid data leaves the storage all AIR rather than half read
+    if (!read(data, end)) {
+        reset(m_size);
+        return false;
+    }
+    return true;
+}
+
+bool BlockStorage::read(const unsigned char*& data, const unsigned char* end) {
+    // read the palette
+    if (data == end || *data == 0 || end - data < 1 + *data) {
+        return false;
+    }
+    unsigned int paletteSize = *data++;
+    reset(m_size, Block::BlockType::AIR);
+    m_palette.clear();
+    m_paletteIndex[static_cast<int>(Block::BlockType::AIR)] = NO_INDEX;
+    for (unsigned int i = 0; i < paletteSize; ++i) {
+        unsigned int type = *data++;
+        if (type >= static_cast<unsigned int>(Block::BlockType::NUM_BLOCK_TYPES) || m_paletteIndex[type] != NO_INDEX) {
+            return false;
+        }
+        m_paletteIndex[type] = static_cast<unsigned char>(i);
+        m_palette.push_back(static_cast<Block::BlockType>(type));
+    }
+    if (paletteSize == 1) {
+        return true;
+    }
+
+    // read the index words
+    if (data == end) {
+        return false;
+    }
+    m_bitsPerIndex = *data++;
+    if ((m_bitsPerIndex != 1 && m_bitsPerIndex != 2 && m_bitsPerIndex != 4 && m_bitsPerIndex != 8) || (1u << m_bitsPerIndex) < paletteSize) {
+        return false;
+    }
+    m_words.resize((static_cast<std::size_t>(m_size) * m_bitsPerIndex + 63) / 64);
+    for (std::size_t i = 0; i < m_words.size();) {
+        unsigned long long run;
+        if (!getVarint(data, end, run) || run == 0 || run > m_words.size() - i || end - data < 8) {
+            return false;
+        }
+        unsigned long long word = 0;
+        for (int byte = 0; byte < 8; ++byte) {
+            word |= static_cast<unsigned long long>(*data++) << (byte * 8);
+        }
+        std::fill_n(m_words.begin() + i, run, word);
+        i += static_cast<std::size_t>(run);
+    }
+
+    // every index must point into the palette
+    unsigned long long mask = (1ull << m_bitsPerIndex) - 1;
+    for (int i = 0; i < m_size && (1u << m_bitsPerIndex) > paletteSize; ++i) {
+        unsigned int bit = i * m_bitsPerIndex;
+        if (((m_words[bit / 64] >> (bit % 64)) & mask) >= paletteSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BlockStorage::setIndex(int index, unsigned int paletteIndex) {
+    unsigned int bit = index * m_bitsPerIndex;
+    unsigned long long mask = ((1ull << m_bitsPerIndex) - 1) << (bit % 64);
+    unsigned long long& word = m_words[bit / 64];
+    word = (word & ~mask) | (static_cast<unsigned long long>(paletteIndex) << (bit % 64));
+}
+
+void BlockStorage::widen() {
+    // read every index at the old width, then write it back at double the width (or 1 bit if there were none)
+    std::vector<unsigned int> indices(m_size, 0);
+    for (int i = 0; m_bitsPerIndex != 0 && i < m_size; ++i) {
+        unsigned int bit = i * m_bitsPerIndex;
+        indices[i] = static_cast<unsigned int>((m_words[bit / 64] >> (bit % 64)) & ((1ull << m_bitsPerIndex) - 1));
+    }
+    m_bitsPerIndex = m_bitsPerIndex == 0 ? 1 : m_bitsPerIndex * 2;
+    m_words.assign((static_cast<std::size_t>(m_size) * m_bitsPerIndex + 63) / 64, 0);
+    for (int i = 0; i < m_size; ++i) {
+        setIndex(i, indices[i]);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef BLOCK_STORAGE_H_INCLUDED
+#define BLOCK_STORAGE_H_INCLUDED
+
+#include "BlockInfo.h"
+
+#include <vector>
+#include <cstddef>
+
+// Stores a fixed number of blocks as indices into a small palette of the block types that have
+// been put in it. The indices are packed into 64-bit words using 0, 1, 2, 4, or 8 bits each (a
+// power of two, so an index never crosses two words), just enough to index every palette entry.
+// The width grows automatically as new block types are put in. With 0 bits every block is the
+// one type in the palette and no index words are stored at all.
+class BlockStorage {
+    int m_size;
+    unsigned int m_bitsPerIndex;
+    std::vector<Block::BlockType> m_palette;
+    std::vector<unsigned long long> m_words;
+    unsigned char m_paletteIndex[static_cast<int>(Block::BlockType::NUM_BLOCK_TYPES)]; // NO_INDEX if not in the palette
+
+    static constexpr unsigned char NO_INDEX = 0xFF;
+
+public:
+    BlockStorage(int size, Block::BlockType fill = Block::BlockType::AIR);
+
+    // for ObjectPool: both start over with every block set to fill (AIR for clear), keeping the
+    // memory of the index words for the blocks that will be put in next
+    void clear();
+    void reset(int size, Block::BlockType fill = Block::BlockType::AIR);
+
+    inline Block::BlockType get(int index) const {
+        if (m_bitsPerIndex == 0) {
+            return m_palette[0];
+        }
+        unsigned int bit = index * m_bitsPerIndex;
+        unsigned long long mask = (1ull << m_bitsPerIndex) - 1;
+        return m_palette[(m_words[bit / 64] >> (bit % 64)) & mask];
+    }
+
+    void getRange(int index, int count, Block::BlockType* blocks) const;
+    void put(int index, Block::BlockType block);
+    // replaces every block with blocks[0..size), with a palette of just the types in it
+    void assign(const Block::BlockType* blocks);
+    void compact();
+    bool isUniform() const;
+    std::size_t getMemoryUsage() const;
+
+    // The palette, then the index words as runs of equal words. deserialize reads from data up
+    // to end, advances data past what it read, and returns false (leaving every block AIR) if
+    // the data is not valid.
+    void serialize(std::vector<unsigned char>& data) const;
+    bool deserialize(const unsigned char*& data, const unsigned char* end);
+
+private:
+    bool read(const unsigned char*& data, const unsigned char* end);
+    void setIndex(int index, unsigned int paletteIndex);
+    void widen();
+};
+
+#endif
@@ -1,64 +1,835 @@
 #include "Chunk.h"
 #include "BlockInfo.h"
-#include "ShaderProgram.h"
-#include "Mesh.h"
+#include "VertexArena.h"
+#include "TerrainGenerator.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <FastNoise/FastNoise.h>
 
+#include <iostream>
 #include <new>
+#include <memory>
+#include <array>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <random>
 
-Chunk::Chunk(float x, float z, ShaderProgram* shader) : m_posX{ x }, m_posZ{ z }, m_shader{ shader } {
-    m_blocks = new Blocks();
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// the index of the lowest set bit (bits must not be 0)
+static inline int countTrailingZeros(unsigned long long bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// a block type's bit in a set of block types
+static constexpr unsigned int typeBit(Block::BlockType type) {
+    return 1u << static_cast<unsigned int>(type);
+}
+
+// a face direction's bit in a set of face directions
+static constexpr unsigned int faceBit(Block::BlockFace face) {
+    return 1u << static_cast<unsigned int>(face);
+}
+
+// Everything a thread needs to mesh a chunk. This is a few megabytes, so each thread allocates
+// it once, the first time it builds a mesh, and reuses it for every mesh after that.
+struct Chunk::MeshScratch {
+    unsigned int m_vertexData[BLOCKS_PER_SECTION * Block::VERTICES_PER_BLOCK]; // one section at a time
+    PaddedBlocks m_paddedBlocks;
+    FaceMasks m_faceMasks;
+};
+
+// Each face direction of a section is meshed into its own run of the vertex data, with room
+// for a face on every block. the scratch memory holds exactly one section's runs
+static constexpr int FACE_RUN = BLOCKS_PER_SECTION * Block::UINTS_PER_FACE;
+static_assert(Block::FACES_PER_BLOCK * FACE_RUN == BLOCKS_PER_SECTION * Block::VERTICES_PER_BLOCK * Block::UINTS_PER_VERTEX, "the runs must fill the scratch vertex data");
+
+// the most slices of a section and the largest slice that the greedy mesher merges faces in, along any axis
+static constexpr int MAX_SLICES = std::max({ CHUNK_LENGTH, SECTION_HEIGHT, CHUNK_WIDTH });
+static constexpr int MAX_SLICE_AREA = std::max({ SECTION_HEIGHT * CHUNK_WIDTH, CHUNK_WIDTH * CHUNK_LENGTH, CHUNK_LENGTH * SECTION_HEIGHT });
+
+Chunk::MeshScratch& Chunk::getMeshScratch() {
+    thread_local std::unique_ptr<MeshScratch> scratch = std::make_unique<MeshScratch>();
+    return *scratch;
+}
+
+ObjectPool<BlockStorage, 256> Chunk::s_blockPool;
+
+Chunk::Chunk(float x, float z, VertexArena* arena) : m_sections{} {
+    std::fill_n(m_meshes, SECTIONS_PER_CHUNK, VertexArena::NO_ALLOCATION);
+    reset(x, z, arena);
+}
+
+void Chunk::reset(float x, float z, VertexArena* arena) {
+    m_posX = x;
+    m_posZ = z;
+    m_arena = arena;
+    m_hasMesh = false;
+    m_dirtySections = 0;
+    m_saved = false;
+    m_minSolidY = CHUNK_HEIGHT;
+    m_maxSolidY = -1;
+    std::fill_n(m_rowBlocks, CHUNK_HEIGHT, static_cast<unsigned short>(0));
+    std::fill_n(&m_heightmap[0][0], CHUNK_LENGTH * CHUNK_WIDTH, static_cast<unsigned char>(0));
+    std::fill_n(m_sectionConnections, SECTIONS_PER_CHUNK, ALL_CONNECTED);
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        m_sections[section] = s_blockPool.acquire(BLOCKS_PER_SECTION);
+    }
     m_neighbors[0] = m_neighbors[1] = m_neighbors[2] = m_neighbors[3] = nullptr;
-    generateTerrain();
 }
 
-void Chunk::updateMesh() {
-    if (m_mesh != nullptr) {
-        delete m_mesh;
+void Chunk::clear() {
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if (m_meshes[section] != VertexArena::NO_ALLOCATION) {
+            m_arena->release(m_meshes[section]);
+            m_meshes[section] = VertexArena::NO_ALLOCATION;
+        }
+        if (m_sections[section] != nullptr) {
+            s_blockPool.release(m_sections[section]);
+            m_sections[section] = nullptr;
+        }
+    }
+    m_hasMesh = false;
+}
+
+void Chunk::printPoolStats() {
+    s_blockPool.printStats("Block storage");
+}
+
+void Chunk::runBenchmark(const TerrainGenerator& terrain) {
+    // a 6x6 square of chunks away from where the world starts, and a ring of chunks around it
+    // that only have their terrain heights, which the square's last stage reads. the 4x4 chunks
+    // inside the square's edge are meshed, so all of their neighbors have blocks
+    constexpr int SIZE = 8;
+    constexpr int ORIGIN = 1000;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    for (int x = 0; x < SIZE; ++x) {
+        for (int z = 0; z < SIZE; ++z) {
+            chunks.push_back(std::make_unique<Chunk>(static_cast<float>(ORIGIN + x), static_cast<float>(ORIGIN + z), nullptr));
+        }
+    }
+    auto at = [&](int x, int z) -> Chunk& {
+        return *chunks[x * SIZE + z];
+    };
+    auto isInside = [](int x, int z) {
+        return x > 0 && z > 0 && x < SIZE - 1 && z < SIZE - 1;
+    };
+    constexpr int INSIDE = (SIZE - 2) * (SIZE - 2);
+    for (int x = 0; x < SIZE; ++x) {
+        for (int z = 0; z < SIZE; ++z) {
+            if (!isInside(x, z)) {
+                at(x, z).generateTerrainHeights(terrain);
+            }
+        }
+    }
+    typedef std::chrono::steady_clock Clock;
+    auto microseconds = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    };
+
+    Clock::time_point start = Clock::now();
+    for (int x = 1; x < SIZE - 1; ++x) {
+        for (int z = 1; z < SIZE - 1; ++z) {
+            const Chunk* area[3][3];
+            for (int dx = -1; dx <= 1; ++dx) {
+                for (int dz = -1; dz <= 1; ++dz) {
+                    area[1 + dx][1 + dz] = &at(x + dx, z + dz);
+                }
+            }
+            for (int stage = 0; stage < TerrainGenerator::STAGE_COUNT; ++stage) {
+                at(x, z).generateStage(terrain, stage, area);
+            }
+        }
+    }
+    double generateTime = microseconds(start) / INSIDE;
+
+    for (int x = 2; x < SIZE - 2; ++x) {
+        for (int z = 2; z < SIZE - 2; ++z) {
+            at(x, z).addNeighbor(&at(x + 1, z), PLUS_X);
+            at(x, z).addNeighbor(&at(x - 1, z), MINUS_X);
+            at(x, z).addNeighbor(&at(x, z + 1), PLUS_Z);
+            at(x, z).addNeighbor(&at(x, z - 1), MINUS_Z);
+        }
+    }
+    double meshTimes[3];
+    const MeshMode modes[3] = { MeshMode::NAIVE, MeshMode::BITMASK, MeshMode::GREEDY };
+    for (int mode = 0; mode < 3; ++mode) {
+        start = Clock::now();
+        for (int x = 2; x < SIZE - 2; ++x) {
+            for (int z = 2; z < SIZE - 2; ++z) {
+                at(x, z).buildMesh(modes[mode]);
+            }
+        }
+        meshTimes[mode] = microseconds(start) / ((SIZE - 4) * (SIZE - 4));
+    }
+
+    // random blocks in the square, picked before timing
+    constexpr int ACCESSES = 1 << 20;
+    std::minstd_rand random(1);
+    std::vector<std::array<int, 4>> accesses(ACCESSES);
+    for (std::array<int, 4>& access : accesses) {
+        access = { static_cast<int>(random() % (CHUNK_LENGTH * INSIDE)), static_cast<int>(random() % CHUNK_HEIGHT),
+            static_cast<int>(random() % CHUNK_WIDTH), static_cast<int>(random() % 3) };
+    }
+    auto chunkOf = [&](const std::array<int, 4>& access) -> Chunk& {
+        int chunk = access[0] / CHUNK_LENGTH;
+        return at(1 + chunk / (SIZE - 2), 1 + chunk % (SIZE - 2));
+    };
+    start = Clock::now();
+    unsigned int solidBlocks = 0;
+    for (const std::array<int, 4>& access : accesses) {
+        solidBlocks += chunkOf(access).get(access[0] % CHUNK_LENGTH, access[1], access[2]) != Block::BlockType::AIR;
+    }
+    volatile unsigned int keep = solidBlocks; // so the gets aren't optimized away
+    (void)keep;
+    double getTime = microseconds(start) * 1000.0 / ACCESSES;
+    const Block::BlockType types[3] = { Block::BlockType::AIR, Block::BlockType::STONE, Block::BlockType::DIRT };
+    start = Clock::now();
+    for (const std::array<int, 4>& access : accesses) {
+        chunkOf(access).put(access[0] % CHUNK_LENGTH, access[1], access[2], types[access[3]]);
+    }
+    double putTime = microseconds(start) * 1000.0 / ACCESSES;
+
+    std::cout << "Layout " << Layout::NAME << ": generate " << generateTime << " us, mesh " << meshTimes[0] << " us naive, "
+        << meshTimes[1] << " us bitmask, " << meshTimes[2] << " us greedy (per chunk), get " << getTime << " ns, put "
+        << putTime << " ns\n";
+}
+
+bool Chunk::checkMeshModes(int chunkCount) {
+    // Every section of a chunk and of its neighbors is either one block type (air included) or
+    // random blocks at a random density, with air as the transparent type. So the shortcuts for
+    // uniform and hidden sections are checked along with the per-block paths. Sometimes a
+    // neighbor is left out, and the border counts as air.
+    std::minstd_rand random(1);
+    const unsigned int blockTypes = static_cast<unsigned int>(Block::BlockType::NUM_BLOCK_TYPES);
+    auto fill = [&](Chunk& chunk) {
+        for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+            bool uniform = random() % 4 == 0;
+            Block::BlockType uniformType = static_cast<Block::BlockType>(random() % blockTypes);
+            unsigned int density = random() % 101; // the percentage of the blocks that are not air
+            for (int x = 0; x < CHUNK_LENGTH; ++x) {
+                for (int y = section * SECTION_HEIGHT; y < (section + 1) * SECTION_HEIGHT; ++y) {
+                    for (int z = 0; z < CHUNK_WIDTH; ++z) {
+                        Block::BlockType block = uniformType;
+                        if (!uniform) {
+                            block = random() % 100 < density ? static_cast<Block::BlockType>(1 + random() % (blockTypes - 1)) : Block::BlockType::AIR;
+                        }
+                        if (block != Block::BlockType::AIR) {
+                            chunk.setBlock(x, y, z, block);
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    typedef std::array<unsigned int, Block::UINTS_PER_FACE> Face;
+    std::size_t facesCompared = 0;
+    int mismatches = 0;
+    for (int i = 0; i < chunkCount; ++i) {
+        Chunk chunk(0.0f, 0.0f, nullptr);
+        fill(chunk);
+        std::vector<std::unique_ptr<Chunk>> neighbors;
+        const int offsets[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+        for (int direction = 0; direction < 4; ++direction) {
+            if (random() % 8 == 0) {
+                continue;
+            }
+            neighbors.push_back(std::make_unique<Chunk>(static_cast<float>(offsets[direction][0]), static_cast<float>(offsets[direction][1]), nullptr));
+            fill(*neighbors.back());
+            chunk.addNeighbor(neighbors.back().get(), static_cast<Direction>(direction));
+        }
+
+        // the backends emit each direction's faces in a different order, but must find the same set
+        MeshData naive = chunk.buildMesh(MeshMode::NAIVE);
+        MeshData bitmask = chunk.buildMesh(MeshMode::BITMASK);
+        for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+            const unsigned int* naiveRun = naive.m_vertexData[section].data();
+            const unsigned int* bitmaskRun = bitmask.m_vertexData[section].data();
+            for (unsigned int face = 0; face < Block::FACES_PER_BLOCK; ++face) {
+                unsigned int naiveCount = naive.m_faceCounts[section][face], bitmaskCount = bitmask.m_faceCounts[section][face];
+                std::vector<Face> naiveFaces(naiveCount), bitmaskFaces(bitmaskCount);
+                for (Face& naiveFace : naiveFaces) {
+                    std::copy_n(naiveRun, Block::UINTS_PER_FACE, naiveFace.data());
+                    naiveRun += Block::UINTS_PER_FACE;
+                }
+                for (Face& bitmaskFace : bitmaskFaces) {
+                    std::copy_n(bitmaskRun, Block::UINTS_PER_FACE, bitmaskFace.data());
+                    bitmaskRun += Block::UINTS_PER_FACE;
+                }
+                std::sort(naiveFaces.begin(), naiveFaces.end());
+                std::sort(bitmaskFaces.begin(), bitmaskFaces.end());
+                facesCompared += naiveCount;
+                if (naiveFaces != bitmaskFaces) {
+                    if (mismatches < 10) {
+                        std::cout << "Random chunk " << i << ", section " << section << ", direction " << face << ": " << naiveCount
+                            << " naive faces and " << bitmaskCount << " bitmask faces DO NOT match\n";
+                    }
+                    ++mismatches;
+                }
+            }
+        }
+    }
+    std::cout << "Mesh check: " << chunkCount << " random chunks, " << facesCompared << " naive faces compared, "
+        << (mismatches == 0 ? "the bitmask faces match" : std::to_string(mismatches) + " groups DO NOT match") << '\n';
+    return mismatches == 0;
+}
+
+void Chunk::updateMesh(MeshMode mode, unsigned int sectionMask) {
+    // mesh and upload one section at a time straight from the scratch memory
+    unsigned int* data = getMeshScratch().m_vertexData;
+    unsigned int visibleSections = prepareMeshScratch(mode, sectionMask);
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if ((sectionMask >> section) & 1) {
+            unsigned int faceCounts[Block::FACES_PER_BLOCK] = {};
+            unsigned int size = (visibleSections >> section) & 1 ? getSectionVertexData(data, mode, section, faceCounts) : 0;
+            setSectionMesh(section, size, data, faceCounts);
+            m_sectionConnections[section] = getSectionConnections(section);
+        }
+    }
+    m_dirtySections &= ~sectionMask;
+    m_hasMesh = true;
+}
+
+Chunk::MeshData Chunk::buildMesh(MeshMode mode, unsigned int sectionMask) const {
+    // copy the data out of this thread's scratch memory so it can be handed to another thread
+    MeshData meshData{};
+    meshData.m_sectionMask = sectionMask;
+    unsigned int* data = getMeshScratch().m_vertexData;
+    unsigned int visibleSections = prepareMeshScratch(mode, sectionMask);
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if ((visibleSections >> section) & 1) {
+            unsigned int size = getSectionVertexData(data, mode, section, meshData.m_faceCounts[section]);
+            meshData.m_vertexData[section].assign(data, data + size / sizeof(unsigned int));
+        }
+        meshData.m_connections[section] = (sectionMask >> section) & 1 ? getSectionConnections(section) : ALL_CONNECTED;
+    }
+    return meshData;
+}
+
+void Chunk::setMesh(const MeshData& meshData) {
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if ((meshData.m_sectionMask >> section) & 1) {
+            const std::vector<unsigned int>& vertexData = meshData.m_vertexData[section];
+            setSectionMesh(section, static_cast<unsigned int>(vertexData.size() * sizeof(unsigned int)), vertexData.data(), meshData.m_faceCounts[section]);
+            m_sectionConnections[section] = meshData.m_connections[section];
+        }
+    }
+    m_hasMesh = true;
+}
+
+void Chunk::setSectionMesh(int section, unsigned int size, const unsigned int* data, const unsigned int* faceCounts) {
+    // a section's mesh keeps its place in the arena while the new data fits, and gives it back
+    // once the section has nothing left to draw
+    glm::vec3 chunkOffset(m_posX * CHUNK_LENGTH, 0.0f, m_posZ * CHUNK_WIDTH);
+    m_meshes[section] = m_arena->allocate(m_meshes[section], size, data, faceCounts, chunkOffset);
+}
+
+bool Chunk::isSectionHidden(int section) const {
+    // Only sections of a single block type are skipped. An all-air section has no faces, and an
+    // all-opaque section has none either when every block around it is opaque: the sections
+    // above and below, and the same section of all four neighbors.
+    auto isOpaque = [](const BlockStorage* blocks) {
+        return blocks->isUniform() && !Block::isTransparent(blocks->get(0));
+    };
+    const BlockStorage* blocks = m_sections[section];
+    if (!blocks->isUniform()) {
+        return false;
+    }
+    if (blocks->get(0) == Block::BlockType::AIR) {
+        return true;
+    }
+    if (!isOpaque(blocks) || section == 0 || section == SECTIONS_PER_CHUNK - 1) {
+        return false; // the bottom face of the world is drawn like any other face
+    }
+    if (!isOpaque(m_sections[section - 1]) || !isOpaque(m_sections[section + 1])) {
+        return false;
+    }
+    for (const Chunk* neighbor : m_neighbors) {
+        if (neighbor == nullptr || !isOpaque(neighbor->m_sections[section])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned long long Chunk::getSectionConnections(int section) const {
+    // Flood fill each group of transparent blocks that touch each other, and connect every pair
+    // of the section's sides that the group reaches. A section of one type is open or closed
+    // from every side. Otherwise prepareMeshScratch must have been called for the section.
+    const BlockStorage* storage = m_sections[section];
+    if (storage->isUniform()) {
+        return Block::isTransparent(storage->get(0)) ? ALL_CONNECTED : 0;
+    }
+    constexpr int X_STEP = SECTION_HEIGHT * CHUNK_WIDTH, Y_STEP = CHUNK_WIDTH;
+    // the step to the next block towards each side, in Block::BlockFace order
+    constexpr int STEPS[Block::FACES_PER_BLOCK] = { X_STEP, -X_STEP, Y_STEP, -Y_STEP, 1, -1 };
+    bool transparent[static_cast<int>(Block::BlockType::NUM_BLOCK_TYPES)];
+    for (int type = 0; type < static_cast<int>(Block::BlockType::NUM_BLOCK_TYPES); ++type) {
+        transparent[type] = Block::isTransparent(static_cast<Block::BlockType>(type));
+    }
+
+    // opaque blocks start out visited, so the fill only has to look at visited. the rows
+    // outside the solid range are all air, and weren't copied into the padded blocks
+    const auto& blocks = getMeshScratch().m_paddedBlocks.m_blockArray;
+    bool visited[BLOCKS_PER_SECTION];
+    for (int x = 0; x < CHUNK_LENGTH; ++x) {
+        for (int y = 0; y < SECTION_HEIGHT; ++y) {
+            const int Y = section * SECTION_HEIGHT + y;
+            const bool air = Y < m_minSolidY || Y > m_maxSolidY;
+            for (int z = 0; z < CHUNK_WIDTH; ++z) {
+                visited[x * X_STEP + y * Y_STEP + z] = !air && !transparent[static_cast<int>(blocks[x + 1][Y + 1][z + 1])];
+            }
+        }
+    }
+
+    unsigned short stack[BLOCKS_PER_SECTION];
+    unsigned long long connections = 0;
+    for (int start = 0; start < BLOCKS_PER_SECTION && connections != ALL_CONNECTED; ++start) {
+        if (visited[start]) {
+            continue;
+        }
+        visited[start] = true;
+        stack[0] = static_cast<unsigned short>(start);
+        int stackSize = 1;
+        unsigned int sides = 0; // a bit for each Block::BlockFace the group touches
+        auto visit = [&](int next) {
+            if (!visited[next]) {
+                visited[next] = true;
+                stack[stackSize++] = static_cast<unsigned short>(next);
+            }
+        };
+        while (stackSize > 0) {
+            const int current = stack[--stackSize];
+            const int x = current / X_STEP, y = current / Y_STEP % SECTION_HEIGHT, z = current % CHUNK_WIDTH;
+            const bool inside[Block::FACES_PER_BLOCK] = { x + 1 < CHUNK_LENGTH, x > 0, y + 1 < SECTION_HEIGHT, y > 0, z + 1 < CHUNK_WIDTH, z > 0 };
+            for (unsigned int side = 0; side < Block::FACES_PER_BLOCK; ++side) {
+                if (inside[side]) {
+                    visit(current + STEPS[side]);
+                } else {
+                    sides |= 1u << side;
+                }
+            }
+        }
+        for (unsigned int from = 0; from < Block::FACES_PER_BLOCK; ++from) {
+            if ((sides >> from) & 1) {
+                connections |= static_cast<unsigned long long>(sides) << (from * Block::FACES_PER_BLOCK);
+            }
+        }
+    }
+    return connections;
+}
+
+unsigned int Chunk::prepareMeshScratch(MeshMode mode, unsigned int sectionMask) const {
+    // fill the scratch memory for the sections in sectionMask that can have visible faces,
+    // and return a mask of those sections
+    unsigned int visibleSections = 0;
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if ((sectionMask >> section) & 1 && !isSectionHidden(section)) {
+            visibleSections |= 1u << section;
+        }
+    }
+    MeshScratch& scratch = getMeshScratch();
+    getPaddedBlocks(scratch.m_paddedBlocks, visibleSections);
+    if (mode != MeshMode::NAIVE) {
+        getFaceMasks(scratch.m_paddedBlocks, scratch.m_faceMasks, visibleSections);
+    }
+    return visibleSections;
+}
+
+unsigned int Chunk::getVertexData(unsigned int* data, MeshMode mode) const {
+    // the whole chunk, one section after another
+    unsigned int size = 0;
+    unsigned int visibleSections = prepareMeshScratch(mode, ALL_SECTIONS);
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if ((visibleSections >> section) & 1) {
+            unsigned int faceCounts[Block::FACES_PER_BLOCK];
+            size += getSectionVertexData(data + size / sizeof(unsigned int), mode, section, faceCounts);
+        }
+    }
+    return size;
+}
+
+unsigned int Chunk::getSectionVertexData(unsigned int* data, MeshMode mode, int section, unsigned int* faceCounts) const {
+    // The backends write the faces of each direction to their own run of FACE_RUN uints and
+    // count them in faceCounts. The runs are then moved together, so the faces end up grouped by
+    // direction and can be drawn one direction at a time. prepareMeshScratch must have been
+    // called for the section first.
+    std::fill_n(faceCounts, Block::FACES_PER_BLOCK, 0u);
+    switch (mode) {
+        case MeshMode::NAIVE:   getVertexData(data, section, faceCounts); break;
+        case MeshMode::BITMASK: getBitmaskVertexData(data, section, faceCounts); break;
+        case MeshMode::GREEDY:  getGreedyVertexData(data, section, faceCounts); break;
+    }
+    unsigned int* end = data + faceCounts[0] * Block::UINTS_PER_FACE;
+    for (unsigned int face = 1; face < Block::FACES_PER_BLOCK; ++face) {
+        const unsigned int* run = data + face * FACE_RUN;
+        end = std::copy(run, run + faceCounts[face] * Block::UINTS_PER_FACE, end);
+    }
+    return static_cast<unsigned int>(end - data) * sizeof(unsigned int);
+}
+
+void Chunk::printMeshStats() const {
+    typedef std::array<unsigned int, Block::UINTS_PER_FACE> Face;
+    std::vector<Face> naiveFaces(BLOCKS_PER_CHUNK * Block::FACES_PER_BLOCK);
+    std::vector<Face> bitmaskFaces(BLOCKS_PER_CHUNK * Block::FACES_PER_BLOCK);
+    unsigned int greedyQuads = getVertexData(naiveFaces.front().data(), MeshMode::GREEDY) / Block::BYTES_PER_FACE;
+    unsigned int naiveQuads = getVertexData(naiveFaces.front().data(), MeshMode::NAIVE) / Block::BYTES_PER_FACE;
+    unsigned int bitmaskQuads = getVertexData(bitmaskFaces.front().data(), MeshMode::BITMASK) / Block::BYTES_PER_FACE;
+    int hiddenSections = 0;
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        hiddenSections += isSectionHidden(section);
+    }
+    std::cout << "Chunk (" << m_posX << ", " << m_posZ << "): " << naiveQuads << " naive quads, "
+        << greedyQuads << " greedy quads";
+    if (greedyQuads > 0) {
+        std::cout << " (" << static_cast<float>(naiveQuads) / greedyQuads << "x fewer)";
+    }
+    std::cout << ", " << hiddenSections << '/' << SECTIONS_PER_CHUNK << " sections skipped";
+
+    // the bitmask backend emits the faces in a different order, but it must find the same set of faces
+    naiveFaces.resize(naiveQuads);
+    bitmaskFaces.resize(bitmaskQuads);
+    std::sort(naiveFaces.begin(), naiveFaces.end());
+    std::sort(bitmaskFaces.begin(), bitmaskFaces.end());
+    if (naiveFaces != bitmaskFaces) {
+        std::cout << " - bitmask faces DO NOT match the naive faces!";
+    }
+    std::cout << '\n';
+}
+
+void Chunk::generateStage(const TerrainGenerator& terrain, int stage, const Chunk* const area[3][3]) {
+    if (stage == TerrainGenerator::HEIGHTMAP) {
+        if (terrain.hasDensity()) {
+            unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH];
+            terrain.getSolidBlocks(m_posX, m_posZ, solid);
+            setTerrainHeights(solid);
+            fillSolidBlocks(solid);
+        } else {
+            generateTerrainHeights(terrain);
+        }
+        return;
+    }
+    if (stage == TerrainGenerator::SURFACE) {
+        if (!terrain.hasDensity()) {
+            fillSurface();
+        }
+        return;
+    }
+
+    // the features of the chunks around this one that reach into it
+    const int chunkX = static_cast<int>(m_posX), chunkZ = static_cast<int>(m_posZ);
+    std::vector<TerrainGenerator::Sphere> spheres;
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dz = -1; dz <= 1; ++dz) {
+            if (stage == TerrainGenerator::CAVES) {
+                terrain.getCaves(chunkX + dx, chunkZ + dz, spheres);
+            } else if (stage == TerrainGenerator::ORES) {
+                terrain.getOrePockets(chunkX + dx, chunkZ + dz, spheres);
+            } else if (stage == TerrainGenerator::DECORATIONS) {
+                terrain.getBoulders(chunkX + dx, chunkZ + dz, area[1 + dx][1 + dz]->m_terrainHeights, spheres);
+            }
+        }
+    }
+    constexpr unsigned int SOLID = typeBit(Block::BlockType::GRASS) | typeBit(Block::BlockType::DIRT) | typeBit(Block::BlockType::STONE);
+    for (const TerrainGenerator::Sphere& sphere : spheres) {
+        if (stage == TerrainGenerator::CAVES) {
+            fillSphere(sphere.m_x, sphere.m_y, sphere.m_z, sphere.m_radius, Block::BlockType::AIR, SOLID);
+        } else if (stage == TerrainGenerator::ORES) {
+            fillSphere(sphere.m_x, sphere.m_y, sphere.m_z, sphere.m_radius, Block::BlockType::DIRT, typeBit(Block::BlockType::STONE));
+        } else {
+            fillSphere(sphere.m_x, sphere.m_y, sphere.m_z, sphere.m_radius, Block::BlockType::STONE, typeBit(Block::BlockType::AIR));
+        }
+    }
+
+    if (stage == TerrainGenerator::STAGE_COUNT - 1) {
+        // the features may have left sections with more bits per block than they need
+        for (BlockStorage* blocks : m_sections) {
+            blocks->compact();
+        }
+    }
+}
+
+void Chunk::generateTerrainHeights(const TerrainGenerator& terrain) {
+    if (terrain.hasDensity()) {
+        unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH];
+        terrain.getSolidBlocks(m_posX, m_posZ, solid);
+        setTerrainHeights(solid);
+        return;
+    }
+    int groundHeight[CHUNK_LENGTH][CHUNK_WIDTH];
+    terrain.getGroundHeights(m_posX, m_posZ, groundHeight);
+    for (int x = 0; x < CHUNK_LENGTH; ++x) {
+        for (int z = 0; z < CHUNK_WIDTH; ++z) {
+            m_terrainHeights[x][z] = static_cast<unsigned char>(std::min(std::max(groundHeight[x][z], 0), CHUNK_HEIGHT - 1));
+        }
     }
-    m_mesh = new Mesh();
-    unsigned int* data = new unsigned int[BLOCKS_PER_CHUNK * Block::VERTICES_PER_BLOCK];
-    unsigned int size = getVertexData(data);
-    m_mesh->setVertexData(size, data);
-    delete[] data;
 }
 
-void Chunk::generateTerrain() {
-    FastNoise noise;
+void Chunk::fillSurface() {
+    // each section is filled in as a whole, so its palette and indices are only built once
+    Block::BlockType blocks[BLOCKS_PER_SECTION];
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        for (int X = 0; X < CHUNK_LENGTH; ++X) {
+            for (int Y = section * SECTION_HEIGHT; Y < (section + 1) * SECTION_HEIGHT; ++Y) {
+                for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
+                    int depth = m_terrainHeights[X][Z] - Y;
+                    Block::BlockType block = Block::BlockType::AIR;
+                    if (depth > 3) {
+                        block = Block::BlockType::STONE;
+                    } else if (depth > 0) {
+                        block = Block::BlockType::DIRT;
+                    } else if (depth == 0) {
+                        block = Block::BlockType::GRASS;
+                    }
+                    blocks[blockIndex(X, Y, Z)] = block;
+                }
+            }
+        }
+        m_sections[section]->assign(blocks);
+    }
+    updateHeightmap();
+}
+
+void Chunk::fillSolidBlocks(const unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH]) {
+    // Down each column, the first solid block under air is grass, the three under that dirt and
+    // the rest stone, just like the heightmap terrain. run counts the solid blocks in a row (up
+    // to 5, which is stone). The loops over a row of z have no branches, so they vectorize when
+    // the layout stores z in order.
+    // Everything above the highest block of a slice is air (m_terrainHeights must be set).
+    Block::BlockType blocks[SECTIONS_PER_CHUNK][BLOCKS_PER_SECTION];
+    for (int X = 0; X < CHUNK_LENGTH; ++X) {
+        int top = *std::max_element(m_terrainHeights[X], m_terrainHeights[X] + CHUNK_WIDTH);
+        for (int Y = CHUNK_HEIGHT - 1; Y > top; --Y) {
+            for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
+                blocks[Y / SECTION_HEIGHT][blockIndex(X, Y, Z)] = Block::BlockType::AIR;
+            }
+        }
+        unsigned char run[CHUNK_WIDTH] = {};
+        for (int Y = top; Y >= 0; --Y) {
+            Block::BlockType* section = blocks[Y / SECTION_HEIGHT];
+            for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
+                unsigned char count = static_cast<unsigned char>(std::min(run[Z] + 1, 5) * solid[X][Y][Z]);
+                run[Z] = count;
+                section[blockIndex(X, Y, Z)] = count == 0 ? Block::BlockType::AIR : count == 1 ? Block::BlockType::GRASS :
+                    count < 5 ? Block::BlockType::DIRT : Block::BlockType::STONE;
+            }
+        }
+    }
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        m_sections[section]->assign(blocks[section]);
+    }
+    updateHeightmap();
+}
+
+void Chunk::setTerrainHeights(const unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH]) {
+    // the highest solid block of each column (0 if there are none)
     for (int X = 0; X < CHUNK_LENGTH; ++X) {
         for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
-            float noiseX = X + CHUNK_LENGTH * m_posX;
-            float noiseZ = Z + CHUNK_WIDTH * m_posZ;
-            int groundHeight = static_cast<int>(50.0 + (noise.GetSimplexFractal(noiseX, noiseZ) + 1.0) / 2.0 * 30.0);
-            for (int Y = 0; Y <= groundHeight - 4; ++Y) {
-                put(X, Y, Z, Block::BlockType::STONE);
+            int Y = CHUNK_HEIGHT - 1;
+            while (Y > 0 && solid[X][Y][Z] == 0) {
+                --Y;
+            }
+            m_terrainHeights[X][Z] = static_cast<unsigned char>(Y);
+        }
+    }
+}
+
+void Chunk::fillSphere(float x, float y, float z, float radius, Block::BlockType block, unsigned int replacedTypes) {
+    // the sphere in the chunk's block coordinates, clipped to the chunk
+    x -= CHUNK_LENGTH * m_posX;
+    z -= CHUNK_WIDTH * m_posZ;
+    int minX = std::max(static_cast<int>(std::floor(x - radius)), 0), maxX = std::min(static_cast<int>(std::floor(x + radius)), CHUNK_LENGTH - 1);
+    int minY = std::max(static_cast<int>(std::floor(y - radius)), 0), maxY = std::min(static_cast<int>(std::floor(y + radius)), CHUNK_HEIGHT - 1);
+    int minZ = std::max(static_cast<int>(std::floor(z - radius)), 0), maxZ = std::min(static_cast<int>(std::floor(z + radius)), CHUNK_WIDTH - 1);
+    for (int X = minX; X <= maxX; ++X) {
+        for (int Y = minY; Y <= maxY; ++Y) {
+            for (int Z = minZ; Z <= maxZ; ++Z) {
+                // measured to the middle of the block
+                float dx = X + 0.5f - x, dy = Y + 0.5f - y, dz = Z + 0.5f - z;
+                if (dx * dx + dy * dy + dz * dz > radius * radius) {
+                    continue;
+                }
+                Block::BlockType old = m_sections[Y / SECTION_HEIGHT]->get(blockIndex(X, Y, Z));
+                if (replacedTypes & typeBit(old)) {
+                    setBlock(X, Y, Z, block);
+                }
+            }
+        }
+    }
+}
+
+void Chunk::serialize(std::vector<unsigned char>& data) const {
+    for (const BlockStorage* blocks : m_sections) {
+        blocks->serialize(data);
+    }
+}
+
+bool Chunk::deserialize(const unsigned char* data, std::size_t size) {
+    const unsigned char* end = data + size;
+    bool valid = true;
+    for (BlockStorage* blocks : m_sections) {
+        valid = valid && blocks->deserialize(data, end);
+    }
+    if (!valid || data != end) {
+        for (BlockStorage* blocks : m_sections) {
+            blocks->reset(BLOCKS_PER_SECTION);
+        }
+        return false;
+    }
+    updateHeightmap();
+    m_saved = true;
+    return true;
+}
+
+bool Chunk::isSaved() const {
+    return m_saved;
+}
+
+void Chunk::markSaved() {
+    m_saved = true;
+}
+
+void Chunk::updateHeightmap() {
+    // count the non-air blocks of every row and find the top of every column, after the
+    // sections were filled in as a whole. uniform sections are handled without reading them
+    std::fill_n(m_rowBlocks, CHUNK_HEIGHT, static_cast<unsigned short>(0));
+    std::fill_n(&m_heightmap[0][0], CHUNK_LENGTH * CHUNK_WIDTH, static_cast<unsigned char>(0));
+    Block::BlockType row[CHUNK_WIDTH];
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        const BlockStorage* blocks = m_sections[section];
+        if (blocks->isUniform()) {
+            if (blocks->get(0) != Block::BlockType::AIR) {
+                std::fill_n(&m_rowBlocks[section * SECTION_HEIGHT], SECTION_HEIGHT, static_cast<unsigned short>(CHUNK_LENGTH * CHUNK_WIDTH));
+                std::fill_n(&m_heightmap[0][0], CHUNK_LENGTH * CHUNK_WIDTH, static_cast<unsigned char>((section + 1) * SECTION_HEIGHT));
             }
-            put(X, groundHeight - 3, Z, Block::BlockType::DIRT);
-            put(X, groundHeight - 2, Z, Block::BlockType::DIRT);
-            put(X, groundHeight - 1, Z, Block::BlockType::DIRT);
-            put(X, groundHeight, Z, Block::BlockType::GRASS);
-            for (int Y = groundHeight + 1; Y < CHUNK_HEIGHT; ++Y) {
-                put(X, Y, Z, Block::BlockType::AIR);
+            continue;
+        }
+        for (int x = 0; x < CHUNK_LENGTH; ++x) {
+            for (int y = section * SECTION_HEIGHT; y < (section + 1) * SECTION_HEIGHT; ++y) {
+                getRow(*blocks, x, y, row);
+                int count = 0;
+                for (int z = 0; z < CHUNK_WIDTH; ++z) {
+                    bool solid = row[z] != Block::BlockType::AIR;
+                    count += solid;
+                    m_heightmap[x][z] = solid ? static_cast<unsigned char>(y + 1) : m_heightmap[x][z];
+                }
+                m_rowBlocks[y] = static_cast<unsigned short>(m_rowBlocks[y] + count);
             }
         }
     }
+    updateSolidRange();
+}
+
+void Chunk::updateSolidRange() {
+    // the lowest and highest rows with a non-air block
+    m_minSolidY = 0;
+    while (m_minSolidY < CHUNK_HEIGHT && m_rowBlocks[m_minSolidY] == 0) {
+        ++m_minSolidY;
+    }
+    m_maxSolidY = CHUNK_HEIGHT - 1;
+    while (m_maxSolidY >= 0 && m_rowBlocks[m_maxSolidY] == 0) {
+        --m_maxSolidY;
+    }
+}
+
+void Chunk::updateColumnHeight(int x, int z) {
+    // the column's top block was removed, so look down it for the next one
+    int y = m_heightmap[x][z] - 1;
+    while (y > 0 && m_sections[(y - 1) / SECTION_HEIGHT]->get(blockIndex(x, y - 1, z)) == Block::BlockType::AIR) {
+        --y;
+    }
+    m_heightmap[x][z] = static_cast<unsigned char>(y);
 }
 
 Chunk::~Chunk() {
-    delete m_mesh;
-    delete m_blocks;
+    clear();
 }
 
 void Chunk::put(int x, int y, int z, Block::BlockType block) {
-    m_blocks->m_blockArray[x][y][z] = block;
+    if (get(x, y, z) == block) {
+        return;
+    }
+    setBlock(x, y, z, block);
+    m_saved = false;
+
+    // the faces of this block and of the six blocks around it may have changed, so the
+    // sections holding those blocks have to be remeshed
+    markDirty(y);
+    if (y % SECTION_HEIGHT == 0 && y > 0) {
+        markDirty(y - 1);
+    }
+    if (y % SECTION_HEIGHT == SECTION_HEIGHT - 1 && y < CHUNK_HEIGHT - 1) {
+        markDirty(y + 1);
+    }
+    if (x == CHUNK_LENGTH - 1 && m_neighbors[PLUS_X] != nullptr) {
+        m_neighbors[PLUS_X]->markDirty(y);
+    }
+    if (x == 0 && m_neighbors[MINUS_X] != nullptr) {
+        m_neighbors[MINUS_X]->markDirty(y);
+    }
+    if (z == CHUNK_WIDTH - 1 && m_neighbors[PLUS_Z] != nullptr) {
+        m_neighbors[PLUS_Z]->markDirty(y);
+    }
+    if (z == 0 && m_neighbors[MINUS_Z] != nullptr) {
+        m_neighbors[MINUS_Z]->markDirty(y);
+    }
+}
+
+unsigned int Chunk::getDirtySections() const {
+    return m_dirtySections;
+}
+
+void Chunk::clearDirtySections() {
+    m_dirtySections = 0;
+}
+
+void Chunk::markDirty(int y) {
+    m_dirtySections |= 1u << (y / SECTION_HEIGHT);
+}
+
+void Chunk::setBlock(int x, int y, int z, Block::BlockType block) {
+    // put without marking anything dirty. used while generating, when there is no mesh yet
+    // and the neighbors may be in use by other threads
+    BlockStorage* blocks = m_sections[y / SECTION_HEIGHT];
+    bool wasSolid = blocks->get(blockIndex(x, y, z)) != Block::BlockType::AIR;
+    bool solid = block != Block::BlockType::AIR;
+    blocks->put(blockIndex(x, y, z), block);
+    if (solid == wasSolid) {
+        return;
+    }
+    // keep the heightmap and the solid range up to date, looking through at most one column
+    // and the row counts
+    if (solid) {
+        ++m_rowBlocks[y];
+        m_heightmap[x][z] = static_cast<unsigned char>(std::max<int>(m_heightmap[x][z], y + 1));
+        m_minSolidY = std::min(m_minSolidY, y);
+        m_maxSolidY = std::max(m_maxSolidY, y);
+    } else {
+        --m_rowBlocks[y];
+        if (m_heightmap[x][z] == y + 1) {
+            updateColumnHeight(x, z);
+        }
+        if (m_rowBlocks[y] == 0 && (y == m_minSolidY || y == m_maxSolidY)) {
+            updateSolidRange();
+        }
+    }
 }
 
 Block::BlockType Chunk::get(int x, int y, int z) const {
     if (x >= 0 && y >= 0 && z >= 0 && x < CHUNK_LENGTH && y < CHUNK_HEIGHT && z < CHUNK_WIDTH) {
-        return m_blocks->m_blockArray[x][y][z];
+        return m_sections[y / SECTION_HEIGHT]->get(blockIndex(x, y, z));
     }
     if (x > CHUNK_LENGTH - 1 && m_neighbors[PLUS_X] != nullptr) {
         return m_neighbors[PLUS_X]->get(0, y, z);
@@ -76,62 +847,331 @@ Block::BlockType Chunk::get(int x, int y, int z) const {
     return Block::BlockType::AIR;
 }
 
-void Chunk::render(glm::mat4 viewMatrix, float zoom, float scrRatio) {
-    // send the MVP matrices to the shaders
-    glm::vec3 translation(m_posX * CHUNK_LENGTH, 0.0f, m_posZ * CHUNK_WIDTH);
-    m_shader->addUniformMat4f("u_model", glm::translate(glm::mat4(1.0f), translation));
-    m_shader->addUniformMat4f("u_view", viewMatrix);
-    glm::mat4 projection = glm::perspective(glm::radians(zoom), scrRatio, 0.1f, 300.0f);
-    m_shader->addUniformMat4f("u_projection", projection);
-    m_mesh->render(m_shader);
+bool Chunk::isVisible(const Frustum& frustum) const {
+    if (m_maxSolidY < m_minSolidY) {
+        return false; // there is nothing to draw
+    }
+    glm::vec3 boxMin(m_posX * CHUNK_LENGTH, static_cast<float>(m_minSolidY), m_posZ * CHUNK_WIDTH);
+    glm::vec3 boxMax(boxMin.x + CHUNK_LENGTH, static_cast<float>(m_maxSolidY + 1), boxMin.z + CHUNK_WIDTH);
+    return frustum.intersects(boxMin, boxMax);
+}
+
+bool Chunk::isConnected(int section, Block::BlockFace from, Block::BlockFace to) const {
+    return (m_sectionConnections[section] >> (static_cast<int>(from) * Block::FACES_PER_BLOCK + static_cast<int>(to))) & 1;
+}
+
+int Chunk::render(const glm::vec3& cameraPosition, unsigned int sectionMask) {
+    // A face can only be seen from in front of it. The +x faces of the chunk are at x = 1 to
+    // CHUNK_LENGTH (in the chunk's coordinates), so from x <= 1 none of them can be seen, and
+    // the same goes for the other directions. The y faces depend on each section's rows.
+    const glm::vec3 camera = cameraPosition - glm::vec3(m_posX * CHUNK_LENGTH, 0.0f, m_posZ * CHUNK_WIDTH);
+    unsigned int chunkFaces = VertexArena::ALL_FACES;
+    if (camera.x <= 1.0f) {
+        chunkFaces &= ~faceBit(Block::BlockFace::PLUS_X);
+    }
+    if (camera.x >= CHUNK_LENGTH - 1.0f) {
+        chunkFaces &= ~faceBit(Block::BlockFace::MINUS_X);
+    }
+    if (camera.z <= 1.0f) {
+        chunkFaces &= ~faceBit(Block::BlockFace::PLUS_Z);
+    }
+    if (camera.z >= CHUNK_WIDTH - 1.0f) {
+        chunkFaces &= ~faceBit(Block::BlockFace::MINUS_Z);
+    }
+    int sectionsDrawn = 0;
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if (m_meshes[section] == VertexArena::NO_ALLOCATION || ((sectionMask >> section) & 1) == 0) {
+            continue;
+        }
+        unsigned int faces = chunkFaces;
+        if (camera.y <= section * SECTION_HEIGHT + 1.0f) {
+            faces &= ~faceBit(Block::BlockFace::PLUS_Y);
+        }
+        if (camera.y >= (section + 1) * SECTION_HEIGHT - 1.0f) {
+            faces &= ~faceBit(Block::BlockFace::MINUS_Y);
+        }
+        m_arena->draw(m_meshes[section], faces);
+        ++sectionsDrawn;
+    }
+    return sectionsDrawn;
 }
 
 void Chunk::addNeighbor(Chunk* chunk, Direction direction) {
     m_neighbors[direction] = chunk;
 }
 
-unsigned int Chunk::getVertexData(unsigned int* data) const {
-    // record the current byte address
-    unsigned int* start = data;
-    for (int x = 0; x < CHUNK_LENGTH; ++x) {
-        for (int y = 0; y < CHUNK_HEIGHT; ++y) {
-            for (int z = 0; z < CHUNK_WIDTH; ++z) {
+bool Chunk::hasAllNeighbors() const {
+    return m_neighbors[PLUS_X] && m_neighbors[MINUS_X] && m_neighbors[PLUS_Z] && m_neighbors[MINUS_Z];
+}
+
+bool Chunk::hasMesh() const {
+    return m_hasMesh;
+}
+
+int Chunk::getHeight(int x, int z) const {
+    return m_heightmap[x][z];
+}
+
+int Chunk::getMinSolidY() const {
+    return m_minSolidY;
+}
+
+int Chunk::getMaxSolidY() const {
+    return m_maxSolidY;
+}
+
+std::size_t Chunk::getMemoryUsage() const {
+    // the block data plus the meshes' pages of the arena's vertex buffer on the GPU
+    std::size_t usage = sizeof(Chunk);
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        usage += m_sections[section]->getMemoryUsage();
+        if (m_meshes[section] != VertexArena::NO_ALLOCATION) {
+            usage += m_arena->getAllocationSize(m_meshes[section]);
+        }
+    }
+    return usage;
+}
+
+void Chunk::getVertexData(unsigned int* data, int section, unsigned int* faceCounts) const {
+    const auto& blocks = getMeshScratch().m_paddedBlocks.m_blockArray;
+    // adds a face to the end of its direction's run
+    auto addFace = [&](Block::BlockFace face, int x, int y, int z, Block::BlockType block) {
+        unsigned int& count = faceCounts[static_cast<int>(face)];
+        setBlockFaceData(data + static_cast<int>(face) * FACE_RUN + count * Block::UINTS_PER_FACE, x, y, z, Block::getData(block, face));
+        ++count;
+    };
+    // only the rows between the lowest block and the top of the slice's highest column can have
+    // faces (in the padded blocks' coordinates, one above the chunk's)
+    const int minY = std::max(section * SECTION_HEIGHT, m_minSolidY) + 1;
+    for (int x = 1; x <= CHUNK_LENGTH; ++x) {
+        const int top = *std::max_element(m_heightmap[x - 1], m_heightmap[x - 1] + CHUNK_WIDTH);
+        const int maxY = std::min((section + 1) * SECTION_HEIGHT, top) + 1;
+        for (int y = minY; y < maxY; ++y) {
+            for (int z = 1; z <= CHUNK_WIDTH; ++z) {
                 // skip if this block is air
-                Block::BlockType currentBlock = get(x, y, z);
+                Block::BlockType currentBlock = blocks[x][y][z];
                 if (currentBlock == Block::BlockType::AIR) {
                     continue;
                 }
                 // check each of the six sides to see if this block is adjacent to a transparent block
-                if (Block::isTransparent(get(x + 1, y, z))) {
-                    setBlockFaceData(data, x, y, z, Block::getData(currentBlock, Block::BlockFace::PLUS_X));
-                    data += Block::UINTS_PER_FACE;
+                if (Block::isTransparent(blocks[x + 1][y][z])) {
+                    addFace(Block::BlockFace::PLUS_X, x - 1, y - 1, z - 1, currentBlock);
                 }
-                if (Block::isTransparent(get(x - 1, y, z))) {
-                    setBlockFaceData(data, x, y, z, Block::getData(currentBlock, Block::BlockFace::MINUS_X));
-                    data += Block::UINTS_PER_FACE;
+                if (Block::isTransparent(blocks[x - 1][y][z])) {
+                    addFace(Block::BlockFace::MINUS_X, x - 1, y - 1, z - 1, currentBlock);
                 }
-                if (Block::isTransparent(get(x, y + 1, z))) {
-                    setBlockFaceData(data, x, y, z, Block::getData(currentBlock, Block::BlockFace::PLUS_Y));
-                    data += Block::UINTS_PER_FACE;
+                if (Block::isTransparent(blocks[x][y + 1][z])) {
+                    addFace(Block::BlockFace::PLUS_Y, x - 1, y - 1, z - 1, currentBlock);
                 }
-                if (Block::isTransparent(get(x, y - 1, z))) {
-                    setBlockFaceData(data, x, y, z, Block::getData(currentBlock, Block::BlockFace::MINUS_Y));
-                    data += Block::UINTS_PER_FACE;
+                if (Block::isTransparent(blocks[x][y - 1][z])) {
+                    addFace(Block::BlockFace::MINUS_Y, x - 1, y - 1, z - 1, currentBlock);
                 }
-                if (Block::isTransparent(get(x, y, z + 1))) {
-                    setBlockFaceData(data, x, y, z, Block::getData(currentBlock, Block::BlockFace::PLUS_Z));
-                    data += Block::UINTS_PER_FACE;
+                if (Block::isTransparent(blocks[x][y][z + 1])) {
+                    addFace(Block::BlockFace::PLUS_Z, x - 1, y - 1, z - 1, currentBlock);
                 }
-                if (Block::isTransparent(get(x, y, z - 1))) {
-                    setBlockFaceData(data, x, y, z, Block::getData(currentBlock, Block::BlockFace::MINUS_Z));
-                    data += Block::UINTS_PER_FACE;
+                if (Block::isTransparent(blocks[x][y][z - 1])) {
+                    addFace(Block::BlockFace::MINUS_Z, x - 1, y - 1, z - 1, currentBlock);
                 }
             }
         }
     }
+}
 
-    // return the number of bytes that were initialized
-    return static_cast<unsigned int>(data - start) * sizeof(unsigned int);
+void Chunk::getBitmaskVertexData(unsigned int* data, int section, unsigned int* faceCounts) const {
+    const FaceMasks& faceMasks = getMeshScratch().m_faceMasks;
+    const auto& blocks = getMeshScratch().m_paddedBlocks.m_blockArray;
+    // the section's rows of each column, all in one word since 64 is a multiple of the section height
+    const int minY = section * SECTION_HEIGHT;
+    const unsigned long long sectionBits = ~0ull >> (64 - SECTION_HEIGHT) << (minY % 64);
+    for (int x = 0; x < CHUNK_LENGTH; ++x) {
+        for (int z = 0; z < CHUNK_WIDTH; ++z) {
+            for (unsigned int face = 0; face < Block::FACES_PER_BLOCK; ++face) {
+                const ColumnMask& column = faceMasks.m_columns[face][x][z];
+                unsigned int* run = data + face * FACE_RUN;
+                // visit each set bit, clearing the lowest one every iteration
+                for (unsigned long long bits = column.m_bits[minY / 64] & sectionBits; bits != 0; bits &= bits - 1) {
+                    int y = minY / 64 * 64 + countTrailingZeros(bits);
+                    Block::BlockType block = blocks[x + 1][y + 1][z + 1];
+                    setBlockFaceData(run + faceCounts[face]++ * Block::UINTS_PER_FACE, x, y, z, Block::getData(block, static_cast<Block::BlockFace>(face)));
+                }
+            }
+        }
+    }
+}
+
+void Chunk::getPaddedBlocks(PaddedBlocks& padded, unsigned int sectionMask) const {
+    // only the rows of the sections in sectionMask are copied, along with the row above and
+    // below each of them, and of those only the ones next to the chunk's blocks. the rest of
+    // the padded copy is left as it was
+    constexpr Block::BlockType AIR = Block::BlockType::AIR;
+    auto& blocks = padded.m_blockArray;
+    const Chunk* plusX = m_neighbors[PLUS_X];
+    const Chunk* minusX = m_neighbors[MINUS_X];
+    const Chunk* plusZ = m_neighbors[PLUS_Z];
+    const Chunk* minusZ = m_neighbors[MINUS_Z];
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if (((sectionMask >> section) & 1) == 0) {
+            continue;
+        }
+        const int minY = std::max(section * SECTION_HEIGHT, m_minSolidY) - 1;
+        const int maxY = std::min((section + 1) * SECTION_HEIGHT - 1, m_maxSolidY) + 1;
+        for (int y = minY; y <= maxY; ++y) {
+            if (y < 0 || y >= CHUNK_HEIGHT) {
+                // above and below the chunk
+                for (int x = 0; x < CHUNK_LENGTH + 2; ++x) {
+                    std::fill_n(&blocks[x][y + 1][0], CHUNK_WIDTH + 2, AIR);
+                }
+                continue;
+            }
+            const int s = y / SECTION_HEIGHT;
+            for (int x = 0; x < CHUNK_LENGTH; ++x) {
+                getRow(*m_sections[s], x, y, &blocks[x + 1][y + 1][1]);
+                blocks[x + 1][y + 1][CHUNK_WIDTH + 1] = plusZ ? plusZ->m_sections[s]->get(blockIndex(x, y, 0)) : AIR;
+                blocks[x + 1][y + 1][0] = minusZ ? minusZ->m_sections[s]->get(blockIndex(x, y, CHUNK_WIDTH - 1)) : AIR;
+            }
+            for (int z = 0; z < CHUNK_WIDTH; ++z) {
+                blocks[CHUNK_LENGTH + 1][y + 1][z + 1] = plusX ? plusX->m_sections[s]->get(blockIndex(0, y, z)) : AIR;
+                blocks[0][y + 1][z + 1] = minusX ? minusX->m_sections[s]->get(blockIndex(CHUNK_LENGTH - 1, y, z)) : AIR;
+            }
+            // the corners are never next to a block in the chunk
+            blocks[0][y + 1][0] = blocks[0][y + 1][CHUNK_WIDTH + 1] = AIR;
+            blocks[CHUNK_LENGTH + 1][y + 1][0] = blocks[CHUNK_LENGTH + 1][y + 1][CHUNK_WIDTH + 1] = AIR;
+        }
+    }
+}
+
+void Chunk::getFaceMasks(const PaddedBlocks& padded, FaceMasks& masks, unsigned int sectionMask) const {
+    // the non-air and the opaque blocks of each column. opaque also holds the column next to
+    // the chunk on each side, taken from the border of the padded blocks. only the rows that
+    // getPaddedBlocks copied for the same sectionMask are filled in, the rest stay empty (the
+    // rows away from the chunk's blocks can't hold any faces)
+    ColumnMask solid[CHUNK_LENGTH][CHUNK_WIDTH] = {};
+    ColumnMask opaque[CHUNK_LENGTH + 2][CHUNK_WIDTH + 2] = {};
+    for (int section = 0; section < SECTIONS_PER_CHUNK; ++section) {
+        if (((sectionMask >> section) & 1) == 0) {
+            continue;
+        }
+        const int minY = std::max({ section * SECTION_HEIGHT - 1, m_minSolidY - 1, 0 });
+        const int maxY = std::min({ (section + 1) * SECTION_HEIGHT, m_maxSolidY + 1, CHUNK_HEIGHT - 1 });
+        for (int x = 0; x < CHUNK_LENGTH + 2; ++x) {
+            for (int z = 0; z < CHUNK_WIDTH + 2; ++z) {
+                bool inside = x > 0 && x <= CHUNK_LENGTH && z > 0 && z <= CHUNK_WIDTH;
+                for (int y = minY; y <= maxY; ++y) {
+                    Block::BlockType block = padded.m_blockArray[x][y + 1][z];
+                    unsigned long long bit = 1ull << (y % 64);
+                    if (!Block::isTransparent(block)) {
+                        opaque[x][z].m_bits[y / 64] |= bit;
+                    }
+                    if (inside && block != Block::BlockType::AIR) {
+                        solid[x - 1][z - 1].m_bits[y / 64] |= bit;
+                    }
+                }
+            }
+        }
+    }
+
+    // a face is visible if its block is not air and the adjacent block in that direction is
+    // transparent. the +y and -y neighbors are found by shifting the whole column by one bit
+    constexpr int WORDS = CHUNK_HEIGHT / 64;
+    constexpr int SECTIONS_PER_WORD = 64 / SECTION_HEIGHT;
+    for (int x = 0; x < CHUNK_LENGTH; ++x) {
+        for (int z = 0; z < CHUNK_WIDTH; ++z) {
+            const unsigned long long* s = solid[x][z].m_bits;
+            const unsigned long long* o = opaque[x + 1][z + 1].m_bits;
+            for (int w = 0; w < WORDS; ++w) {
+                if (((sectionMask >> (w * SECTIONS_PER_WORD)) & ((1u << SECTIONS_PER_WORD) - 1)) == 0) {
+                    continue; // none of the sections in this word are being meshed
+                }
+                unsigned long long above = (o[w] >> 1) | (w + 1 < WORDS ? o[w + 1] << 63 : 0);
+                unsigned long long below = (o[w] << 1) | (w > 0 ? o[w - 1] >> 63 : 0);
+                using Block::BlockFace;
+                masks.m_columns[static_cast<int>(BlockFace::PLUS_X)][x][z].m_bits[w] = s[w] & ~opaque[x + 2][z + 1].m_bits[w];
+                masks.m_columns[static_cast<int>(BlockFace::MINUS_X)][x][z].m_bits[w] = s[w] & ~opaque[x][z + 1].m_bits[w];
+                masks.m_columns[static_cast<int>(BlockFace::PLUS_Y)][x][z].m_bits[w] = s[w] & ~above;
+                masks.m_columns[static_cast<int>(BlockFace::MINUS_Y)][x][z].m_bits[w] = s[w] & ~below;
+                masks.m_columns[static_cast<int>(BlockFace::PLUS_Z)][x][z].m_bits[w] = s[w] & ~opaque[x + 1][z + 2].m_bits[w];
+                masks.m_columns[static_cast<int>(BlockFace::MINUS_Z)][x][z].m_bits[w] = s[w] & ~opaque[x + 1][z].m_bits[w];
+            }
+        }
+    }
+}
+
+void Chunk::getGreedyVertexData(unsigned int* data, int section, unsigned int* faceCounts) const {
+    // faces are only merged within the section, so each section can be meshed on its own
+    const int origin[3] = { 0, section * SECTION_HEIGHT, 0 };
+    const int size[3] = { CHUNK_LENGTH, SECTION_HEIGHT, CHUNK_WIDTH };
+
+    // The block type of each visible face in every slice (AIR if there is no face there). The
+    // merging below clears every face it uses, so the masks are all AIR again after each face
+    // direction and only have to be cleared once.
+    Block::BlockType masks[MAX_SLICES][MAX_SLICE_AREA];
+    int sliceFaces[MAX_SLICES];
+    std::fill_n(&masks[0][0], MAX_SLICES * MAX_SLICE_AREA, Block::BlockType::AIR);
+    const FaceMasks& faceMasks = getMeshScratch().m_faceMasks;
+    const auto& blocks = getMeshScratch().m_paddedBlocks.m_blockArray;
+    const unsigned long long sectionBits = ~0ull >> (64 - SECTION_HEIGHT) << (origin[1] % 64);
+
+    for (unsigned int face = 0; face < Block::FACES_PER_BLOCK; ++face) {
+        // the faces come in +/- pairs along the x, y, then z axis. d is the axis the face
+        // points along, and u and v are the two axes that lie in the plane of the face
+        const int d = face / 2, u = (d + 1) % 3, v = (d + 2) % 3;
+
+        // sort the visible faces into their slices, visiting only the set bits of each column
+        std::fill_n(sliceFaces, MAX_SLICES, 0);
+        for (int x = 0; x < CHUNK_LENGTH; ++x) {
+            for (int z = 0; z < CHUNK_WIDTH; ++z) {
+                const ColumnMask& column = faceMasks.m_columns[face][x][z];
+                for (unsigned long long bits = column.m_bits[origin[1] / 64] & sectionBits; bits != 0; bits &= bits - 1) {
+                    int y = origin[1] / 64 * 64 + countTrailingZeros(bits);
+                    const int pos[3] = { x, y - origin[1], z };
+                    masks[pos[d]][pos[v] * size[u] + pos[u]] = blocks[x + 1][y + 1][z + 1];
+                    ++sliceFaces[pos[d]];
+                }
+            }
+        }
+
+        for (int slice = 0; slice < size[d]; ++slice) {
+            Block::BlockType* mask = masks[slice];
+            // merge the faces into rectangles, growing each one along u first and then along v
+            for (int j = 0; j < size[v] && sliceFaces[slice] > 0; ++j) {
+                for (int i = 0; i < size[u];) {
+                    Block::BlockType type = mask[j * size[u] + i];
+                    if (type == Block::BlockType::AIR) {
+                        ++i;
+                        continue;
+                    }
+                    int width = 1;
+                    while (i + width < size[u] && mask[j * size[u] + i + width] == type) {
+                        ++width;
+                    }
+                    int height = 1;
+                    for (; j + height < size[v]; ++height) {
+                        int k = 0;
+                        while (k < width && mask[(j + height) * size[u] + i + k] == type) {
+                            ++k;
+                        }
+                        if (k < width) {
+                            break;
+                        }
+                    }
+
+                    // remove the merged faces from the mask so they are not used again
+                    for (int h = 0; h < height; ++h) {
+                        for (int w = 0; w < width; ++w) {
+                            mask[(j + h) * size[u] + i + w] = Block::BlockType::AIR;
+                        }
+                    }
+                    sliceFaces[slice] -= width * height;
+
+                    int quadPos[3], quadSize[3];
+                    quadPos[d] = origin[d] + slice, quadPos[u] = origin[u] + i, quadPos[v] = origin[v] + j;
+                    quadSize[d] = 1, quadSize[u] = width, quadSize[v] = height;
+                    setGreedyFaceData(data + face * FACE_RUN + faceCounts[face]++ * Block::UINTS_PER_FACE, quadPos, quadSize, type, static_cast<Block::BlockFace>(face));
+                    i += width;
+                }
+            }
+        }
+    }
 }
 
 inline void Chunk::setBlockFaceData(unsigned int* data, int x, int y, int z, const unsigned int* blockData) const {
@@ -141,3 +1181,18 @@ inline void Chunk::setBlockFaceData(unsigned int* data, int x, int y, int z, con
         data[vertex] = blockData[vertex] + (x << 23) + (y << 15) + (z << 10);
     }
 }
+
+inline void Chunk::setGreedyFaceData(unsigned int* data, const int* pos, const int* size, Block::BlockType type, Block::BlockFace face) const {
+    const unsigned int* blockData = Block::getData(type, face);
+    unsigned int tile = Block::getTextureTile(type, face);
+    for (unsigned int vertex = 0; vertex < Block::VERTICES_PER_FACE; ++vertex) {
+        // stretch the unit quad's corner (0 or 1 on each axis) to the size of the merged quad
+        unsigned int x = pos[0] + ((blockData[vertex] >> 23) & 0x1F) * size[0];
+        unsigned int y = pos[1] + ((blockData[vertex] >> 15) & 0xFF) * size[1];
+        unsigned int z = pos[2] + ((blockData[vertex] >> 10) & 0x1F) * size[2];
+        // bit 31 marks the quad as tiled, the face takes bits 28-30, and the texture tile's
+        // bottom left corner replaces the tex coords in bits 0-9. The shader repeats the
+        // tile across the quad using the vertex position and the face direction.
+        data[vertex] = (1u << 31) + (static_cast<unsigned int>(face) << 28) + (x << 23) + (y << 15) + (z << 10) + tile;
+    }
+}
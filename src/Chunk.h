@@ -2,45 +2,208 @@
 #define CHUNK_H_INCLUDED
 
 #include "BlockInfo.h"
-#include "ShaderProgram.h"
-#include "Mesh.h"
+#include "BlockStorage.h"
+#include "BlockLayout.h"
+#include "VertexArena.h"
+#include "Frustum.h"
+#include "ObjectPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
 
 inline constexpr int CHUNK_LENGTH = 16;  // x
 inline constexpr int CHUNK_HEIGHT = 128; // y
 inline constexpr int CHUNK_WIDTH = 16;  // z
 inline constexpr int BLOCKS_PER_CHUNK = CHUNK_LENGTH * CHUNK_HEIGHT * CHUNK_WIDTH;
 
+// the chunk is split vertically into sections that are stored and meshed separately
+inline constexpr int SECTION_HEIGHT = 16;
+inline constexpr int SECTIONS_PER_CHUNK = CHUNK_HEIGHT / SECTION_HEIGHT;
+inline constexpr int BLOCKS_PER_SECTION = CHUNK_LENGTH * SECTION_HEIGHT * CHUNK_WIDTH;
+inline constexpr unsigned int ALL_SECTIONS = (1u << SECTIONS_PER_CHUNK) - 1; // bit i is section i
+
+static_assert(CHUNK_HEIGHT % 64 == 0, "columns are stored as whole 64-bit words in the face masks");
+static_assert(CHUNK_HEIGHT % SECTION_HEIGHT == 0 && SECTIONS_PER_CHUNK <= 32, "sections must fill the chunk and fit in a 32-bit mask");
+static_assert(64 % SECTION_HEIGHT == 0, "a section's rows of a column must fall within one word of the face masks");
+
+// The order of the blocks in each section (one of the BlockLayouts), picked at compile time.
+// Chunk::runBenchmark measures the one built in. Sections are saved in this order too, so a
+// world saved with one layout can't be loaded with another.
+#ifndef CHUNK_LAYOUT
+#define CHUNK_LAYOUT BlockLayout::XYZ
+#endif
+
+class TerrainGenerator;
+
 class Chunk {
 
-    struct Blocks {
-        Blocks() = default;
-        Block::BlockType m_blockArray[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH];
+    // the chunk's blocks surrounded by a one block border copied from the neighbors (AIR where
+    // there is no neighbor, and above and below the chunk). The mesher can look at the block
+    // next to any block in the chunk without bounds checks or following neighbor pointers.
+    struct PaddedBlocks {
+        Block::BlockType m_blockArray[CHUNK_LENGTH + 2][CHUNK_HEIGHT + 2][CHUNK_WIDTH + 2];
+    };
+
+    // one bit per block in a column of the chunk (bit y % 64 of word y / 64)
+    struct ColumnMask {
+        unsigned long long m_bits[CHUNK_HEIGHT / 64];
     };
 
-    const float m_posX, m_posZ;
-    Blocks* m_blocks;
-    Mesh* m_mesh;
-    ShaderProgram* m_shader;
+    // the visible faces of every column in the chunk, for each of the six face directions
+    struct FaceMasks {
+        ColumnMask m_columns[Block::FACES_PER_BLOCK][CHUNK_LENGTH][CHUNK_WIDTH];
+    };
+
+    // scratch memory for building meshes (defined in Chunk.cpp)
+    struct MeshScratch;
+
+    // the section storage of every chunk is recycled through this pool. it is only used on
+    // the main thread, where chunks are created
+    static ObjectPool<BlockStorage, 256> s_blockPool;
+
+    float m_posX, m_posZ;
+    BlockStorage* m_sections[SECTIONS_PER_CHUNK]; // a section of only one block type is stored as just that type
+    VertexArena::Handle m_meshes[SECTIONS_PER_CHUNK]; // NO_ALLOCATION for sections without any visible faces
+    bool m_hasMesh;
+    unsigned int m_dirtySections; // sections whose mesh is out of date with their blocks
+    bool m_saved;                 // the blocks are the same as the ones saved on disk
+    VertexArena* m_arena;         // holds the meshes, nullptr for chunks that are never drawn
     Chunk* m_neighbors[4];
+    int m_minSolidY, m_maxSolidY; // the lowest and highest rows with a non-air block (CHUNK_HEIGHT and -1 when there are none)
+    unsigned short m_rowBlocks[CHUNK_HEIGHT];                 // the non-air blocks in each row, which keep the range above up to date
+    unsigned char m_heightmap[CHUNK_LENGTH][CHUNK_WIDTH];      // one above the highest non-air block of each column (0 if there are none)
+    unsigned long long m_sectionConnections[SECTIONS_PER_CHUNK]; // see isConnected, found when the section is meshed
+    unsigned char m_terrainHeights[CHUNK_LENGTH][CHUNK_WIDTH]; // the top block of each column, found by the first generation stage
 
 public:
     enum Direction : unsigned char {
         PLUS_X, MINUS_X, PLUS_Z, MINUS_Z
     };
 
-    Chunk(float x, float z, ShaderProgram* shader);
+    using Layout = CHUNK_LAYOUT<CHUNK_LENGTH, SECTION_HEIGHT, CHUNK_WIDTH>;
+
+    // every face of a section connected to every other, for sections that have not been meshed yet
+    static constexpr unsigned long long ALL_CONNECTED = (1ull << (Block::FACES_PER_BLOCK * Block::FACES_PER_BLOCK)) - 1;
+
+    enum class MeshMode : unsigned char {
+        NAIVE,   // one quad per visible block face, found by checking each neighbor block
+        BITMASK, // the same quads as NAIVE, found a whole column at a time with bitmasks
+        GREEDY,  // coplanar faces of the same block type merged into larger quads
+    };
+
+    // the vertex data and connections of the sections in m_sectionMask (the other vectors are
+    // left empty). each section's faces are grouped by direction, in Block::BlockFace order
+    struct MeshData {
+        unsigned int m_sectionMask;
+        std::vector<unsigned int> m_vertexData[SECTIONS_PER_CHUNK];
+        unsigned int m_faceCounts[SECTIONS_PER_CHUNK][Block::FACES_PER_BLOCK];
+        unsigned long long m_connections[SECTIONS_PER_CHUNK];
+    };
+
+    Chunk(float x, float z, VertexArena* arena);
     ~Chunk();
 
+    // for ObjectPool: clear gives the blocks back to their pool and the meshes back to the
+    // arena, and reset makes a cleared chunk into a new, empty one at (x, z)
+    void clear();
+    void reset(float x, float z, VertexArena* arena);
+
+    // put marks the sections whose faces it changes as dirty, including those of the neighbors
+    // when the block is on the chunk's border. Dirty sections are remeshed by passing
+    // getDirtySections() to updateMesh, which then clears them.
     void put(int x, int y, int z, Block::BlockType block);
     Block::BlockType get(int x, int y, int z) const;
-    void updateMesh();
-    void render(glm::mat4 viewMatrix, float zoom, float scrRatio);
+    unsigned int getDirtySections() const;
+    void clearDirtySections();
+    // runs one stage of the terrain generation (a TerrainGenerator::Stage), after the ones
+    // before it. area[1 + dx][1 + dz] is the chunk dx, dz chunks away (area[1][1] is this one),
+    // and every chunk in it has finished the stage before this one. Only this chunk's blocks
+    // are written, and only what the earlier stages left behind is read from the others, so
+    // neighboring chunks can run the same stage at the same time.
+    void generateStage(const TerrainGenerator& terrain, int stage, const Chunk* const area[3][3]);
+    // the first stage on its own. a chunk loaded from disk needs it for its neighbors' later stages
+    void generateTerrainHeights(const TerrainGenerator& terrain);
+
+    // the blocks of every section, for saving. deserialize fills a new (empty) chunk, and
+    // returns false (leaving it empty) if the data is not valid
+    void serialize(std::vector<unsigned char>& data) const;
+    bool deserialize(const unsigned char* data, std::size_t size);
+    bool isSaved() const;
+    void markSaved();
+    void updateMesh(MeshMode mode = MeshMode::NAIVE, unsigned int sectionMask = ALL_SECTIONS);
+
+    // updateMesh split in two: the vertex data can be built on any thread,
+    // but it has to be uploaded on the thread that owns the OpenGL context
+    MeshData buildMesh(MeshMode mode, unsigned int sectionMask = ALL_SECTIONS) const;
+    void setMesh(const MeshData& meshData);
+    void printMeshStats() const;
+    static void printPoolStats();
+    // times generating, meshing and random gets and puts on chunks made just for it, and prints
+    // the results along with the layout, for comparing builds with different CHUNK_LAYOUTs
+    static void runBenchmark(const TerrainGenerator& terrain);
+    // meshes chunkCount chunks of random blocks, with random neighbors, in NAIVE and BITMASK
+    // mode and prints whether both found the same faces in every direction of every section.
+    // returns true if they did
+    static bool checkMeshModes(int chunkCount = 64);
+    bool isVisible(const Frustum& frustum) const;
+    // Whether a section's face to can be seen from its face from, through a path of transparent
+    // blocks inside the section (block faces stand for the sides of the section). Sections that
+    // have not been meshed yet count as open from every side.
+    bool isConnected(int section, Block::BlockFace from, Block::BlockFace to) const;
+    // Queues the meshes of the sections in sectionMask to be drawn by the arena, and returns how
+    // many it queued. The faces pointing away from the camera in all of a section are left out.
+    int render(const glm::vec3& cameraPosition, unsigned int sectionMask = ALL_SECTIONS);
     void addNeighbor(Chunk* chunk, Direction direction);
+    bool hasAllNeighbors() const;
+    bool hasMesh() const;
+    std::size_t getMemoryUsage() const;
+    // the row above the highest non-air block of column (x, z), or 0 if it has no blocks
+    int getHeight(int x, int z) const;
+    // the lowest and highest rows with a non-air block (min > max when the chunk is empty)
+    int getMinSolidY() const;
+    int getMaxSolidY() const;
 
 private:
-    void generateTerrain();
-    unsigned int getVertexData(unsigned int* data) const;
+    // the index of a block within its section (y / SECTION_HEIGHT)
+    static inline int blockIndex(int x, int y, int z) {
+        return Layout::index(x, y % SECTION_HEIGHT, z);
+    }
+    // the blocks (x, y, 0) to (x, y, CHUNK_WIDTH - 1) of a section, read at once if the layout allows
+    static inline void getRow(const BlockStorage& blocks, int x, int y, Block::BlockType* row) {
+        if constexpr (Layout::Z_ROWS) {
+            blocks.getRange(blockIndex(x, y, 0), CHUNK_WIDTH, row);
+        } else {
+            for (int z = 0; z < CHUNK_WIDTH; ++z) {
+                row[z] = blocks.get(blockIndex(x, y, z));
+            }
+        }
+    }
+
+    static MeshScratch& getMeshScratch();
+    void setBlock(int x, int y, int z, Block::BlockType block);
+    void markDirty(int y);
+    void updateHeightmap();
+    void updateSolidRange();
+    void updateColumnHeight(int x, int z);
+    unsigned long long getSectionConnections(int section) const;
+    void fillSurface();
+    void fillSolidBlocks(const unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH]);
+    void setTerrainHeights(const unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH]);
+    void fillSphere(float x, float y, float z, float radius, Block::BlockType block, unsigned int replacedTypes);
+    bool isSectionHidden(int section) const;
+    unsigned int prepareMeshScratch(MeshMode mode, unsigned int sectionMask) const;
+    void setSectionMesh(int section, unsigned int size, const unsigned int* data, const unsigned int* faceCounts);
+    unsigned int getVertexData(unsigned int* data, MeshMode mode) const;
+    unsigned int getSectionVertexData(unsigned int* data, MeshMode mode, int section, unsigned int* faceCounts) const;
+    void getVertexData(unsigned int* data, int section, unsigned int* faceCounts) const;
+    void getBitmaskVertexData(unsigned int* data, int section, unsigned int* faceCounts) const;
+    void getGreedyVertexData(unsigned int* data, int section, unsigned int* faceCounts) const;
+    void getPaddedBlocks(PaddedBlocks& padded, unsigned int sectionMask) const;
+    void getFaceMasks(const PaddedBlocks& padded, FaceMasks& masks, unsigned int sectionMask) const;
     inline void setBlockFaceData(unsigned int* data, int x, int y, int z, const unsigned int* blockData) const;
+    inline void setGreedyFaceData(unsigned int* data, const int* pos, const int* size, Block::BlockType type, Block::BlockFace face) const;
 };
 
 #endif
@@ -0,0 +1,158 @@
+#include "ChunkIO.h"
+#include "Chunk.h"
+#include "RegionCache.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+
+// how long a saved chunk waits before it is written, so that saving it again replaces it
+static constexpr std::chrono::milliseconds SAVE_DELAY(2000);
+
+static long long chunkKey(int x, int z) {
+    return static_cast<long long>((static_cast<unsigned long long>(static_cast<unsigned int>(x)) << 32) | static_cast<unsigned int>(z));
+}
+
+ChunkIO::ChunkIO(const std::string& directory) : m_regions{ directory }, m_loading{ false }, m_flushesRequested{ 0 },
+    m_flushesDone{ 0 }, m_chunksWritten{ 0 }, m_stopping{ false } {
+    m_thread = std::thread(&ChunkIO::ioLoop, this);
+}
+
+ChunkIO::~ChunkIO() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_loads.clear();
+    }
+    m_condition.notify_one();
+    m_thread.join();
+}
+
+void ChunkIO::load(int x, int z, Chunk* chunk, LoadCallback done) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loads.push_back(Load{ x, z, chunk, std::move(done) });
+    }
+    m_condition.notify_one();
+}
+
+void ChunkIO::save(int x, int z, const Chunk& chunk) {
+    // serialized out here, so the I/O thread isn't holding up other saves meanwhile
+    auto data = std::make_shared<std::vector<unsigned char>>();
+    chunk.serialize(*data);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto [it, added] = m_pendingSaves.try_emplace(chunkKey(x, z), PendingSave{ x, z, nullptr, std::chrono::steady_clock::now() });
+        it->second.m_data = std::move(data); // a chunk saved again keeps its place in the queue
+    }
+    m_condition.notify_one();
+}
+
+void ChunkIO::cancelLoads() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_loads.clear();
+    m_doneCondition.wait(lock, [this]() { return !m_loading; });
+}
+
+void ChunkIO::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    unsigned long long flush = ++m_flushesRequested;
+    m_condition.notify_one();
+    m_doneCondition.wait(lock, [this, flush]() { return m_flushesDone >= flush; });
+}
+
+std::size_t ChunkIO::getQueuedSaves() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingSaves.size();
+}
+
+std::size_t ChunkIO::getChunksWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_chunksWritten;
+}
+
+void ChunkIO::ioLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        // loads first, something is waiting for them
+        if (!m_loads.empty()) {
+            Load load = std::move(m_loads.front());
+            m_loads.pop_front();
+            loadChunk(load, lock);
+            continue;
+        }
+        if (m_flushesDone < m_flushesRequested) {
+            unsigned long long flush = m_flushesRequested;
+            writeSaves(lock);
+            lock.unlock();
+            m_regions.sync();
+            lock.lock();
+            m_flushesDone = flush;
+            m_doneCondition.notify_all();
+            continue;
+        }
+        if (m_stopping) {
+            return;
+        }
+        if (m_pendingSaves.empty()) {
+            m_condition.wait(lock);
+            continue;
+        }
+        // once the oldest save is due, everything waiting goes out with it
+        auto oldest = std::min_element(m_pendingSaves.begin(), m_pendingSaves.end(), [](const auto& a, const auto& b) {
+            return a.second.m_queued < b.second.m_queued;
+        });
+        auto due = oldest->second.m_queued + SAVE_DELAY;
+        if (std::chrono::steady_clock::now() >= due) {
+            writeSaves(lock);
+        } else {
+            m_condition.wait_until(lock, due);
+        }
+    }
+}
+
+void ChunkIO::loadChunk(Load& load, std::unique_lock<std::mutex>& lock) {
+    // a chunk that is still waiting to be written is loaded from its waiting data
+    std::shared_ptr<const std::vector<unsigned char>> pending;
+    auto it = m_pendingSaves.find(chunkKey(load.m_x, load.m_z));
+    if (it != m_pendingSaves.end()) {
+        pending = it->second.m_data;
+    }
+    m_loading = true;
+    lock.unlock();
+
+    bool loaded;
+    if (pending != nullptr) {
+        loaded = load.m_chunk->deserialize(pending->data(), pending->size());
+    } else {
+        loaded = m_regions.loadChunk(load.m_x, load.m_z, *load.m_chunk);
+    }
+    load.m_done(loaded);
+
+    lock.lock();
+    m_loading = false;
+    m_doneCondition.notify_all();
+}
+
+void ChunkIO::writeSaves(std::unique_lock<std::mutex>& lock) {
+    std::unordered_map<long long, PendingSave> saves;
+    saves.swap(m_pendingSaves);
+    lock.unlock();
+
+    // no load can run meanwhile (they are on this thread too), so none can miss these chunks
+    std::vector<RegionCache::SavedChunk> chunks;
+    chunks.reserve(saves.size());
+    for (const auto& [key, save] : saves) {
+        chunks.push_back(RegionCache::SavedChunk{ save.m_x, save.m_z, save.m_data.get() });
+    }
+    m_regions.saveChunks(chunks);
+
+    lock.lock();
+    m_chunksWritten += chunks.size();
+}
@@ -0,0 +1,77 @@
+#ifndef CHUNK_IO_H_INCLUDED
+#define CHUNK_IO_H_INCLUDED
+
+#include "Chunk.h"
+#include "RegionCache.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <chrono>
+#include <cstddef>
+
+// Loads and saves chunks on a thread of its own, so the main thread never waits for the disk.
+// A saved chunk is serialized right away (the chunk can be reused as soon as save returns),
+// but only written once it has waited SAVE_DELAY. Saving the same chunk again before then
+// replaces the waiting data, and the waiting chunks are written together, with one batch of
+// writes per region file. Loads go before saves and see the chunks still waiting to be written.
+class ChunkIO {
+public:
+    // called on the I/O thread with whether the chunk was loaded (false if it was never saved)
+    using LoadCallback = std::function<void(bool loaded)>;
+
+private:
+    struct Load {
+        int m_x, m_z;
+        Chunk* m_chunk;
+        LoadCallback m_done;
+    };
+
+    struct PendingSave {
+        int m_x, m_z;
+        std::shared_ptr<const std::vector<unsigned char>> m_data; // shared with a load reading it
+        std::chrono::steady_clock::time_point m_queued;
+    };
+
+    RegionCache m_regions; // only used on the I/O thread
+    std::deque<Load> m_loads;
+    std::unordered_map<long long, PendingSave> m_pendingSaves; // keyed by the chunk's (x, z) position
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;     // wakes the I/O thread
+    std::condition_variable m_doneCondition; // wakes threads waiting in flush and cancelLoads
+    bool m_loading;                          // the I/O thread is loading a chunk
+    unsigned long long m_flushesRequested, m_flushesDone;
+    std::size_t m_chunksWritten;
+    bool m_stopping;
+    std::thread m_thread;
+
+public:
+    ChunkIO(const std::string& directory);
+    ~ChunkIO();
+    ChunkIO(const ChunkIO&) = delete;
+    ChunkIO& operator=(const ChunkIO&) = delete;
+
+    // loads the saved blocks into chunk (an empty chunk that must stay alive until done is called)
+    void load(int x, int z, Chunk* chunk, LoadCallback done);
+    void save(int x, int z, const Chunk& chunk);
+    // drops the loads that haven't started and waits for the one that has
+    void cancelLoads();
+    // writes every saved chunk and waits until they have reached the disk
+    void flush();
+
+    std::size_t getQueuedSaves() const;
+    std::size_t getChunksWritten() const;
+
+private:
+    void ioLoop();
+    void loadChunk(Load& load, std::unique_lock<std::mutex>& lock);
+    void writeSaves(std::unique_lock<std::mutex>& lock);
+};
+
+#endif
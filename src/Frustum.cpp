@@ -0,0 +1,35 @@
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    // Each plane is the sum or difference of the 4th row of the view-projection matrix and one
+    // of the other rows (Gribb and Hartmann). glm matrices are column-major, so m[col][row].
+    const glm::mat4& m = viewProjection;
+    for (int i = 0; i < 3; ++i) {
+        glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+        glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+        m_planes[2 * i] = w + row;     // left, bottom, near
+        m_planes[2 * i + 1] = w - row; // right, top, far
+    }
+    // normalize the planes so that w is a real distance
+    for (glm::vec4& plane : m_planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersects(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    for (const glm::vec4& plane : m_planes) {
+        // the corner of the box furthest along the plane's normal. If even that corner is
+        // behind the plane, the whole box is outside of the frustum.
+        glm::vec3 corner(
+            plane.x >= 0.0f ? boxMax.x : boxMin.x,
+            plane.y >= 0.0f ? boxMax.y : boxMin.y,
+            plane.z >= 0.0f ? boxMax.z : boxMin.z
+        );
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
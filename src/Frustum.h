@@ -0,0 +1,15 @@
+#ifndef FRUSTUM_H_INCLUDED
+#define FRUSTUM_H_INCLUDED
+
+#include <glm/glm.hpp>
+
+class Frustum {
+    glm::vec4 m_planes[6]; // xyz: normal pointing into the frustum, w: distance from the origin
+
+public:
+    Frustum(const glm::mat4& viewProjection);
+
+    bool intersects(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
+
+#endif
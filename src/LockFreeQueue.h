@@ -0,0 +1,64 @@
+#ifndef LOCK_FREE_QUEUE_H_INCLUDED
+#define LOCK_FREE_QUEUE_H_INCLUDED
+
+#include <atomic>
+#include <vector>
+#include <utility>
+
+// A queue that any number of threads can push to without locking, and that a single consumer
+// thread empties all at once. Pushes go onto an atomic linked list, and the consumer swaps out
+// the whole list in one exchange, so there is never a half-removed node for pushes to race with.
+template <typename T>
+class LockFreeQueue {
+    struct Node {
+        T m_value;
+        Node* m_next;
+    };
+
+    std::atomic<Node*> m_head; // the most recently pushed node
+
+public:
+    LockFreeQueue() : m_head{ nullptr } {}
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    ~LockFreeQueue() {
+        deleteList(m_head.exchange(nullptr));
+    }
+
+    void push(T value) {
+        Node* node = new Node{ std::move(value), m_head.load(std::memory_order_relaxed) };
+        while (!m_head.compare_exchange_weak(node->m_next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    // Move every item in the queue to the back of items, oldest first. Must only be
+    // called from the consumer thread.
+    void popAll(std::vector<T>& items) {
+        Node* node = m_head.exchange(nullptr, std::memory_order_acquire);
+        // the list runs newest to oldest, so reverse it first
+        Node* oldest = nullptr;
+        while (node != nullptr) {
+            Node* next = node->m_next;
+            node->m_next = oldest;
+            oldest = node;
+            node = next;
+        }
+        for (node = oldest; node != nullptr;) {
+            items.push_back(std::move(node->m_value));
+            Node* next = node->m_next;
+            delete node;
+            node = next;
+        }
+    }
+
+private:
+    static void deleteList(Node* node) {
+        while (node != nullptr) {
+            Node* next = node->m_next;
+            delete node;
+            node = next;
+        }
+    }
+};
+
+#endif
@@ -3,6 +3,10 @@
 #include "Texture.h"
 #include "BlockInfo.h"
 #include "Chunk.h"
+#include "UniformBuffer.h"
+#include "Frustum.h"
+#include "World.h"
+#include "TerrainGenerator.h"
 
 #include <glad/glad.h>
 #include <GLFW/GLFW3.h>
@@ -18,6 +22,14 @@ static unsigned int g_scrWidth = 800;
 static unsigned int g_scrHeight = 600;
 const char* WINDOW_TITLE = "OpenGL Window";
 
+// chunks are drawn within this many chunks of the camera, and the loaded chunks may never use more memory than the budget
+const int RENDER_DISTANCE = 12;
+const std::size_t MEMORY_BUDGET = 256 * 1024 * 1024;
+const char* SAVE_DIRECTORY = "saves/world";
+// the saved chunks only fit in with terrain generated from the same seed and settings
+const int WORLD_SEED = 1337;
+const bool OVERHANGS = true; // 3D density noise on top of the heightmap
+
 // This callback function executes whenever the user moves the mouse
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     Camera* camera = reinterpret_cast<Camera*>(glfwGetWindowUserPointer(window));
@@ -56,14 +68,19 @@ static void processInput(GLFWwindow* window, Camera* camera, float deltaTime) {
     }
 }
 
-// print the FPS to the screen every second
-static void displayFPS() {
+// print the FPS, the number of chunks drawn and culled and the mesh uploads in the
+// last frame, and the number of chunks loaded to the screen every second
+static void displayFPS(const World& world) {
     static int FPS = 0;
     static double previousTime = glfwGetTime();
     double currentTime = glfwGetTime();
     ++FPS;
     if (currentTime - previousTime >= 1.0) {
-        std::cout << "FPS: " << FPS << '\n';
+        std::cout << "FPS: " << FPS << " (chunks drawn: " << world.getChunksDrawn() << ", culled: " << world.getChunksCulled()
+            << ", sections drawn: " << world.getSectionsDrawn() << (world.getOcclusionCulling() ? "" : " without occlusion culling")
+            << ", loaded: " << world.getChunkCount() << " using " << world.getMemoryUsage() / (1024 * 1024) << " MB"
+            << ", uploaded: " << world.getBytesUploaded() / 1024 << " KB with " << world.getUploadQueueDepth() << " queued"
+            << ", sections remeshed: " << world.getSectionsRemeshed() << ", saves queued: " << world.getQueuedSaves() << ")\n";
         FPS = 0;
         previousTime = currentTime;
     }
@@ -113,77 +130,122 @@ int main() {
     // enable VSync (tie the FPS to your monitor's refresh rate)
     glfwSwapInterval(1);
 
-    // Set the camera object as the window's user pointer. This makes it accessible 
-    // in callback functions by using glfwGetWindowUserPointer().
-    Camera camera(glm::vec3(0.0f, 80.0f, 0.0f));
-    glfwSetWindowUserPointer(window, reinterpret_cast<void*>(&camera));
-
-    ShaderProgram shader("res/shaders/basic_vertex.glsl", "res/shaders/basic_fragment.glsl");
-    Texture textureSheet("res/textures/texture_sheet.png", 0);
-    shader.addTexture(&textureSheet, "u_texture");
-
-    const int numChunksX = 20;
-    const int numChunksZ = 20;
-    Chunk* chunks[numChunksX][numChunksZ];
-    for (int x = 0; x < numChunksX; ++x) {
-        for (int z = 0; z < numChunksZ; ++z) {
-           chunks[x][z] = new Chunk(static_cast<float>(x), static_cast<float>(z), &shader);
-        }
-    }
-    for (int x = 0; x < numChunksX; ++x) {
-        for (int z = 0; z < numChunksZ; ++z) {
-            if (x > 0) chunks[x][z]->addNeighbor(chunks[x - 1][z], Chunk::MINUS_X);
-            if (z > 0) chunks[x][z]->addNeighbor(chunks[x][z - 1], Chunk::MINUS_Z);
-            if (x < numChunksX - 1) chunks[x][z]->addNeighbor(chunks[x + 1][z], Chunk::PLUS_X);
-            if (z < numChunksZ - 1) chunks[x][z]->addNeighbor(chunks[x][z + 1], Chunk::PLUS_Z);
-        }
-    }
-    for (int x = 0; x < numChunksX; ++x) {
-        for (int z = 0; z < numChunksZ; ++z) {
-            chunks[x][z]->updateMesh();
+    // Everything that owns OpenGL objects lives in this block, so that it is destroyed (and
+    // the world saved) while the context still exists, before glfwTerminate.
+    {
+        // Set the camera object as the window's user pointer. This makes it accessible 
+        // in callback functions by using glfwGetWindowUserPointer().
+        Camera camera(glm::vec3(0.0f, 80.0f, 0.0f));
+        glfwSetWindowUserPointer(window, reinterpret_cast<void*>(&camera));
+
+        ShaderProgram shader("res/shaders/basic_vertex.glsl", "res/shaders/basic_fragment.glsl");
+        Texture textureSheet("res/textures/texture_sheet.png", 0);
+        shader.addTexture(&textureSheet, "u_texture");
+        shader.addUniform1i("u_pageOffsets", World::PAGE_OFFSETS_SLOT);
+
+        // the view and projection matrices are uploaded once per frame into the camera uniform block
+        UniformBuffer cameraUniforms(2 * sizeof(glm::mat4), 0);
+        shader.bindUniformBlock("Camera", cameraUniforms.getBindingPoint());
+
+        // chunks are created and destroyed around the camera as it moves, and saved in SAVE_DIRECTORY
+        std::vector<TerrainGenerator::LayerSettings> densityLayers;
+        if (OVERHANGS) {
+            densityLayers = TerrainGenerator::getDefaultDensityLayers();
         }
-    }
-
-    glClearColor(0.2f, 0.3f, 0.8f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-
-    // variables for deltaTime
-    double previousTime = glfwGetTime();
-    double deltaTime = 0.0f;
+        TerrainGenerator terrain(WORLD_SEED, 50.0f, TerrainGenerator::getDefaultLayers(), densityLayers);
+        World world(&shader, RENDER_DISTANCE, MEMORY_BUDGET, SAVE_DIRECTORY, terrain);
+
+        glClearColor(0.2f, 0.3f, 0.8f, 1.0f);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        // variables for deltaTime
+        double previousTime = glfwGetTime();
+        double deltaTime = 0.0f;
+
+        // used to print the mesh stats only once per press of F1, dig only once per press of F2,
+        // benchmark only once per press of F3, toggle occlusion culling once per press of F4, and
+        // check the mesh modes once per press of F5
+        bool statsKeyWasDown = false;
+        bool digKeyWasDown = false;
+        bool benchmarkKeyWasDown = false;
+        bool cullingKeyWasDown = false;
+        bool checkKeyWasDown = false;
+
+        // render loop
+        while (!glfwWindowShouldClose(window)) {
+            displayFPS(world);
+            double currentTime = glfwGetTime();
+            deltaTime = currentTime - previousTime;
+            previousTime = currentTime;
+            processInput(window, &camera, static_cast<float>(deltaTime));
+
+            // F1 prints the naive vs greedy quad counts of every chunk and how full the pools are
+            bool statsKeyDown = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+            if (statsKeyDown && !statsKeyWasDown) {
+                world.printMeshStats();
+            }
+            statsKeyWasDown = statsKeyDown;
+
+            // F2 digs out a 3x3x3 cube of blocks around the camera
+            bool digKeyDown = glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS;
+            if (digKeyDown && !digKeyWasDown) {
+                glm::ivec3 center = glm::floor(camera.getCameraPosition());
+                for (int x = -1; x <= 1; ++x) {
+                    for (int y = -1; y <= 1; ++y) {
+                        for (int z = -1; z <= 1; ++z) {
+                            world.put(center.x + x, center.y + y, center.z + z, Block::BlockType::AIR);
+                        }
+                    }
+                }
+            }
+            digKeyWasDown = digKeyDown;
 
-    // render loop
-    while (!glfwWindowShouldClose(window)) {
-        displayFPS();
-        double currentTime = glfwGetTime();
-        deltaTime = currentTime - previousTime;
-        previousTime = currentTime;
-        processInput(window, &camera, static_cast<float>(deltaTime));
+            // F3 times generating, meshing and editing chunks with the block layout this was built with
+            bool benchmarkKeyDown = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+            if (benchmarkKeyDown && !benchmarkKeyWasDown) {
+                Chunk::runBenchmark(terrain);
+            }
+            benchmarkKeyWasDown = benchmarkKeyDown;
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // F4 switches occlusion culling on and off, to compare how many sections are drawn
+            bool cullingKeyDown = glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS;
+            if (cullingKeyDown && !cullingKeyWasDown) {
+                world.setOcclusionCulling(!world.getOcclusionCulling());
+            }
+            cullingKeyWasDown = cullingKeyDown;
 
-        float scrRatio = static_cast<float>(g_scrWidth) / g_scrHeight;
-        for (int x = 0; x < numChunksX; ++x) {
-            for (int z = 0; z < numChunksZ; ++z) {
-                chunks[x][z]->render(camera.getViewMatrix(), camera.getZoom(), scrRatio);
+            // F5 compares the faces the naive and bitmask meshers find in chunks of random blocks
+            bool checkKeyDown = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+            if (checkKeyDown && !checkKeyWasDown) {
+                Chunk::checkMeshModes();
+            }
+            checkKeyWasDown = checkKeyDown;
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            float scrRatio = static_cast<float>(g_scrWidth) / g_scrHeight;
+            glm::mat4 cameraMatrices[2] = {
+                camera.getViewMatrix(),
+                glm::perspective(glm::radians(camera.getZoom()), scrRatio, 0.1f, 300.0f),
+            };
+            cameraUniforms.setData(0, sizeof(cameraMatrices), cameraMatrices);
+            Frustum frustum(cameraMatrices[1] * cameraMatrices[0]);
+            world.update(camera.getCameraPosition());
+            world.render(frustum);
+
+            // catch errors
+            GLenum err;
+            while ((err = glGetError()) != GL_NO_ERROR) {
+                std::cout << "OpenGL Error: " << err << '\n';
             }
-        }
 
-        // catch errors
-        GLenum err;
-        while ((err = glGetError()) != GL_NO_ERROR) {
-            std::cout << "OpenGL Error: " << err << '\n';
+            glfwSwapBuffers(window);
+            glfwPollEvents();
         }
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
     }
+    glfwSetWindowUserPointer(window, nullptr);
 
-    for (int x = 0; x < numChunksX; ++x) {
-        for (int z = 0; z < numChunksZ; ++z) {
-            delete chunks[x][z];
-        }
-    }
     glfwTerminate();
     return 0;
 }
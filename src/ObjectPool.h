@@ -0,0 +1,91 @@
+#ifndef OBJECT_POOL_H_INCLUDED
+#define OBJECT_POOL_H_INCLUDED
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+// Hands out objects of type T from slabs of storage allocated SLAB_SIZE objects at a time, so
+// creating and destroying many of them doesn't fragment the heap. A released object is not
+// destroyed: release() calls its clear() and keeps it on a free list, and acquire() hands it
+// out again, calling its reset() with the arguments that would have gone to T's constructor
+// (if there are any). Whatever the object still owns after clear() (heap buffers, OpenGL
+// names) is reused instead of being freed and created again. Objects are only destroyed with
+// the pool. Not thread safe.
+template <typename T, std::size_t SLAB_SIZE = 64>
+class ObjectPool {
+    struct Slab {
+        alignas(T) unsigned char m_storage[SLAB_SIZE * sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Slab>> m_slabs;
+    std::vector<T*> m_free;
+    std::size_t m_constructed; // the objects in the first m_constructed slots have been constructed
+    std::size_t m_inUse;
+    std::size_t m_highWater;   // the most objects that have been in use at once
+
+public:
+    ObjectPool() : m_constructed{ 0 }, m_inUse{ 0 }, m_highWater{ 0 } {}
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() {
+        for (std::size_t i = 0; i < m_constructed; ++i) {
+            slot(i)->~T();
+        }
+    }
+
+    template <typename... Args>
+    T* acquire(Args&&... args) {
+        T* object;
+        if (!m_free.empty()) {
+            object = m_free.back();
+            m_free.pop_back();
+            if constexpr (sizeof...(Args) > 0) {
+                object->reset(std::forward<Args>(args)...);
+            }
+        } else {
+            if (m_constructed == m_slabs.size() * SLAB_SIZE) {
+                m_slabs.push_back(std::unique_ptr<Slab>(new Slab));
+            }
+            object = new (slot(m_constructed)) T(std::forward<Args>(args)...);
+            ++m_constructed;
+        }
+        m_highWater = std::max(m_highWater, ++m_inUse);
+        return object;
+    }
+
+    void release(T* object) {
+        object->clear();
+        m_free.push_back(object);
+        --m_inUse;
+    }
+
+    std::size_t getInUse() const {
+        return m_inUse;
+    }
+
+    std::size_t getCapacity() const {
+        return m_slabs.size() * SLAB_SIZE;
+    }
+
+    std::size_t getHighWater() const {
+        return m_highWater;
+    }
+
+    void printStats(const char* name) const {
+        std::cout << name << ": " << m_inUse << " in use, " << m_free.size() << " free, "
+            << getCapacity() << " slots in " << m_slabs.size() << " slabs (high water " << m_highWater << ")\n";
+    }
+
+private:
+    T* slot(std::size_t index) {
+        return reinterpret_cast<T*>(m_slabs[index / SLAB_SIZE]->m_storage + index % SLAB_SIZE * sizeof(T));
+    }
+};
+
+#endif
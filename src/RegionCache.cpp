@@ -0,0 +1,76 @@
+#include "RegionCache.h"
+#include "RegionFile.h"
+#include "Chunk.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+
+RegionCache::RegionCache(const std::string& directory) : m_directory{ directory } {
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error) {
+        std::cerr << "Failed to create the save directory " << m_directory << ": " << error.message() << '\n';
+    }
+}
+
+bool RegionCache::loadChunk(int x, int z, Chunk& chunk) {
+    int localX, localZ;
+    RegionFile& region = getRegion(x, z, localX, localZ);
+    const unsigned char* data;
+    std::size_t size;
+    if (!region.read(localX, localZ, data, size)) {
+        return false;
+    }
+    // decode straight out of the mapped file
+    if (!chunk.deserialize(data, size)) {
+        std::cerr << "Chunk (" << x << ", " << z << ") is corrupt in " << m_directory << ", generating it again\n";
+        return false;
+    }
+    return true;
+}
+
+bool RegionCache::saveChunks(const std::vector<SavedChunk>& chunks) {
+    std::unordered_map<RegionFile*, std::vector<RegionFile::ChunkWrite>> writes;
+    for (const SavedChunk& chunk : chunks) {
+        int localX, localZ;
+        RegionFile& region = getRegion(chunk.m_x, chunk.m_z, localX, localZ);
+        writes[&region].push_back(RegionFile::ChunkWrite{ localX, localZ, chunk.m_data });
+    }
+    bool written = true;
+    for (const auto& [region, regionWrites] : writes) {
+        written = region->write(regionWrites) && written;
+        m_unsynced.insert(region);
+    }
+    return written;
+}
+
+bool RegionCache::sync() {
+    bool synced = true;
+    for (RegionFile* region : m_unsynced) {
+        synced = region->sync() && synced;
+    }
+    m_unsynced.clear();
+    return synced;
+}
+
+RegionFile& RegionCache::getRegion(int x, int z, int& localX, int& localZ) {
+    // round down to the region, also for negative positions
+    constexpr int SIZE = RegionFile::REGION_SIZE;
+    int regionX = (x >= 0 ? x : x - SIZE + 1) / SIZE;
+    int regionZ = (z >= 0 ? z : z - SIZE + 1) / SIZE;
+    localX = x - regionX * SIZE;
+    localZ = z - regionZ * SIZE;
+
+    long long key = static_cast<long long>((static_cast<unsigned long long>(static_cast<unsigned int>(regionX)) << 32) | static_cast<unsigned int>(regionZ));
+    std::unique_ptr<RegionFile>& region = m_regions[key];
+    if (region == nullptr) {
+        std::string name = "r." + std::to_string(regionX) + "." + std::to_string(regionZ) + ".region";
+        region = std::make_unique<RegionFile>((std::filesystem::path(m_directory) / name).string());
+    }
+    return *region;
+}
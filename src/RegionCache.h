@@ -0,0 +1,43 @@
+#ifndef REGION_CACHE_H_INCLUDED
+#define REGION_CACHE_H_INCLUDED
+
+#include "Chunk.h"
+#include "RegionFile.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+// Saves chunks to and loads them from the region files in a directory, keeping each region
+// file open (and mapped) once it has been used. Not thread safe, ChunkIO only uses it on its
+// I/O thread.
+class RegionCache {
+public:
+    // a serialized chunk to be saved
+    struct SavedChunk {
+        int m_x, m_z;
+        const std::vector<unsigned char>* m_data;
+    };
+
+private:
+    std::string m_directory;
+    std::unordered_map<long long, std::unique_ptr<RegionFile>> m_regions; // keyed by the region's (x, z) position
+    std::unordered_set<RegionFile*> m_unsynced; // regions written to since the last sync
+
+public:
+    RegionCache(const std::string& directory);
+
+    // fills a new (empty) chunk with its saved blocks, returns false if it was never saved
+    bool loadChunk(int x, int z, Chunk& chunk);
+    // writes the chunks with one batch per region file
+    bool saveChunks(const std::vector<SavedChunk>& chunks);
+    // waits until every chunk saved so far has reached the disk
+    bool sync();
+
+private:
+    RegionFile& getRegion(int x, int z, int& localX, int& localZ);
+};
+
+#endif
@@ -0,0 +1,330 @@
+#include "RegionFile.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static constexpr unsigned char MAGIC[4] = { 'V', 'X', 'R', 'G' };
+static constexpr unsigned int VERSION = 1;
+
+// a file opened (or created) for writing at any offset
+class NativeFile {
+#ifdef _WIN32
+    HANDLE m_handle;
+#else
+    int m_descriptor;
+#endif
+
+public:
+    NativeFile(const std::string& path) {
+#ifdef _WIN32
+        m_handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+        m_descriptor = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+#endif
+    }
+
+    ~NativeFile() {
+#ifdef _WIN32
+        if (m_handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_handle);
+        }
+#else
+        if (m_descriptor >= 0) {
+            close(m_descriptor);
+        }
+#endif
+    }
+
+    NativeFile(const NativeFile&) = delete;
+    NativeFile& operator=(const NativeFile&) = delete;
+
+    bool isOpen() const {
+#ifdef _WIN32
+        return m_handle != INVALID_HANDLE_VALUE;
+#else
+        return m_descriptor >= 0;
+#endif
+    }
+
+    bool writeAt(unsigned long long offset, const unsigned char* data, std::size_t size) {
+        while (size > 0) {
+#ifdef _WIN32
+            OVERLAPPED position = {};
+            position.Offset = static_cast<DWORD>(offset);
+            position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD count = 0;
+            if (!WriteFile(m_handle, data, static_cast<DWORD>(std::min<std::size_t>(size, 1 << 30)), &count, &position)) {
+                return false;
+            }
+#else
+            ssize_t count = pwrite(m_descriptor, data, size, static_cast<off_t>(offset));
+            if (count < 0) {
+                return false;
+            }
+#endif
+            offset += count;
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    bool sync() {
+#ifdef _WIN32
+        return FlushFileBuffers(m_handle) != 0;
+#else
+        return fsync(m_descriptor) == 0;
+#endif
+    }
+};
+
+// the numbers in the header and the table are stored as little endian bytes
+static void putUint32(unsigned char* bytes, unsigned int value) {
+    for (int byte = 0; byte < 4; ++byte) {
+        bytes[byte] = static_cast<unsigned char>(value >> (byte * 8));
+    }
+}
+
+static unsigned int getUint32(const unsigned char* bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<unsigned int>(bytes[3]) << 24);
+}
+
+RegionFile::RegionFile(const std::string& path) : m_path{ path }, m_table{}, m_sectorCount{ 0 }, m_mapping{ nullptr },
+    m_mappingSize{ 0 } {
+    if (map()) {
+        readTable();
+    }
+}
+
+RegionFile::~RegionFile() {
+    unmap();
+}
+
+bool RegionFile::read(int localX, int localZ, const unsigned char*& data, std::size_t& size) {
+    const TableEntry& entry = m_table[localZ * REGION_SIZE + localX];
+    if (entry.m_sector == 0 || !map()) {
+        return false;
+    }
+    // a failed write can leave the file shorter than the table says
+    if ((static_cast<std::size_t>(entry.m_sector) + entry.m_sectors) * SECTOR_SIZE > m_mappingSize ||
+        entry.m_size > static_cast<std::size_t>(entry.m_sectors) * SECTOR_SIZE) {
+        std::cerr << "Chunk (" << localX << ", " << localZ << ") lies outside " << m_path << '\n';
+        return false;
+    }
+    // the chunk's pages are only read in from the disk when the chunk's data is first touched
+    data = m_mapping + static_cast<std::size_t>(entry.m_sector) * SECTOR_SIZE;
+    size = entry.m_size;
+    return true;
+}
+
+bool RegionFile::write(const std::vector<ChunkWrite>& writes) {
+    // Every chunk goes into free sectors, never over its old ones, which are only freed once
+    // the new table is on the disk. A new file starts with the header and an empty table.
+    bool newFile = m_sectorCount < FIRST_SECTOR;
+    if (newFile) {
+        m_sectorCount = FIRST_SECTOR;
+        m_usedSectors.assign(FIRST_SECTOR, true);
+        std::fill(std::begin(m_table), std::end(m_table), TableEntry{ 0, 0, 0 });
+    }
+    std::vector<std::pair<unsigned int, const ChunkWrite*>> placed; // the first sector of each write
+    std::vector<TableEntry> replaced;                                // the old entry of each write, in order
+    for (const ChunkWrite& write : writes) {
+        TableEntry& entry = m_table[write.m_localZ * REGION_SIZE + write.m_localX];
+        replaced.push_back(entry);
+        const unsigned int sectors = static_cast<unsigned int>((write.m_data->size() + SECTOR_SIZE - 1) / SECTOR_SIZE);
+        entry = TableEntry{ allocateSectors(sectors), static_cast<unsigned int>(write.m_data->size()), sectors };
+        placed.emplace_back(entry.m_sector, &write);
+    }
+    std::sort(placed.begin(), placed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // the mapping may not cover the file after it grows (and Windows won't resize a mapped file)
+    unmap();
+    NativeFile file(m_path);
+    bool written = file.isOpen();
+    std::vector<unsigned char> buffer;
+    if (newFile && written) {
+        buffer.assign(FIRST_SECTOR * SECTOR_SIZE, 0);
+        std::memcpy(buffer.data(), MAGIC, sizeof(MAGIC));
+        putUint32(&buffer[4], VERSION);
+        written = file.writeAt(0, buffer.data(), buffer.size());
+    }
+
+    // chunks in consecutive sectors (like all the ones added to the end) go out in one write,
+    // each padded to whole sectors
+    for (std::size_t i = 0; i < placed.size() && written;) {
+        unsigned int firstSector = placed[i].first;
+        unsigned int nextSector = firstSector;
+        buffer.clear();
+        for (; i < placed.size() && placed[i].first == nextSector; ++i) {
+            const std::vector<unsigned char>& data = *placed[i].second->m_data;
+            buffer.insert(buffer.end(), data.begin(), data.end());
+            buffer.resize((buffer.size() + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE, 0);
+            nextSector = firstSector + static_cast<unsigned int>(buffer.size() / SECTOR_SIZE);
+        }
+        written = file.writeAt(static_cast<unsigned long long>(firstSector) * SECTOR_SIZE, buffer.data(), buffer.size());
+    }
+
+    // The disk may write the pages of a file in any order, so the data is flushed before the
+    // table is written, or the table could reach the disk first and point at sectors that
+    // don't hold the chunks yet. The table is flushed before the old sectors are freed, or the
+    // next write could fill them while the table on the disk still points at them.
+    written = written && file.sync();
+    if (written) {
+        buffer.assign(TABLE_SIZE, 0);
+        for (int i = 0; i < CHUNKS_PER_REGION; ++i) {
+            putUint32(&buffer[i * 8], m_table[i].m_sector);
+            putUint32(&buffer[i * 8 + 4], m_table[i].m_size);
+        }
+        written = file.writeAt(HEADER_SIZE, buffer.data(), buffer.size()) && file.sync();
+    }
+
+    if (written) {
+        for (const TableEntry& entry : replaced) {
+            freeSectors(entry.m_sector, entry.m_sectors);
+        }
+    } else {
+        // the table in the file may still point at the old sectors, so the chunks stay there.
+        // going backwards puts back the oldest entry if a chunk was written twice
+        std::cerr << "Failed to write chunks to " << m_path << '\n';
+        for (std::size_t i = writes.size(); i-- > 0;) {
+            TableEntry& entry = m_table[writes[i].m_localZ * REGION_SIZE + writes[i].m_localX];
+            freeSectors(entry.m_sector, entry.m_sectors);
+            entry = replaced[i];
+        }
+        if (newFile) {
+            // the header may not have been written, so the next write starts the file again
+            m_sectorCount = 0;
+            m_usedSectors.clear();
+        }
+    }
+    return written;
+}
+
+bool RegionFile::sync() {
+    NativeFile file(m_path);
+    if (!file.isOpen() || !file.sync()) {
+        std::cerr << "Failed to flush " << m_path << " to the disk\n";
+        return false;
+    }
+    return true;
+}
+
+bool RegionFile::map() {
+    if (m_mapping != nullptr) {
+        return true;
+    }
+    const void* view = nullptr;
+    std::size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = static_cast<std::size_t>(fileSize.QuadPart);
+            CloseHandle(mapping); // the view keeps the mapping open
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(m_path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+        if (mapping != MAP_FAILED) {
+            view = mapping;
+            size = static_cast<std::size_t>(status.st_size);
+        }
+    }
+    close(file); // the mapping keeps the file open
+#endif
+    if (view == nullptr) {
+        return false;
+    }
+    m_mapping = static_cast<const unsigned char*>(view);
+    m_mappingSize = size;
+    return true;
+}
+
+void RegionFile::unmap() {
+    if (m_mapping == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_mapping);
+#else
+    munmap(const_cast<unsigned char*>(m_mapping), m_mappingSize);
+#endif
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+}
+
+void RegionFile::readTable() {
+    if (m_mappingSize < FIRST_SECTOR * SECTOR_SIZE || std::memcmp(m_mapping, MAGIC, sizeof(MAGIC)) != 0 ||
+        getUint32(m_mapping + 4) != VERSION) {
+        std::cerr << "Not a region file: " << m_path << " (it will be overwritten)\n";
+        return;
+    }
+    m_sectorCount = static_cast<unsigned int>(m_mappingSize / SECTOR_SIZE);
+    m_usedSectors.assign(m_sectorCount, false);
+    std::fill_n(m_usedSectors.begin(), FIRST_SECTOR, true);
+    for (int i = 0; i < CHUNKS_PER_REGION; ++i) {
+        const unsigned char* bytes = m_mapping + HEADER_SIZE + i * 8;
+        TableEntry entry{ getUint32(bytes), getUint32(bytes + 4), 0 };
+        entry.m_sectors = static_cast<unsigned int>((entry.m_size + SECTOR_SIZE - 1) / SECTOR_SIZE);
+        // leave out chunks that point outside the file, the file may have been cut short
+        bool valid = entry.m_sector >= FIRST_SECTOR && entry.m_sector < m_sectorCount &&
+            entry.m_sectors <= m_sectorCount - entry.m_sector;
+        m_table[i] = valid ? entry : TableEntry{ 0, 0, 0 };
+        if (valid) {
+            std::fill_n(m_usedSectors.begin() + entry.m_sector, entry.m_sectors, true);
+        }
+    }
+}
+
+unsigned int RegionFile::allocateSectors(unsigned int sectors) {
+    // the first run of free sectors that is long enough. a run of free sectors at the end of
+    // the file is extended past it
+    unsigned int runStart = FIRST_SECTOR;
+    for (unsigned int sector = FIRST_SECTOR; sector < m_sectorCount && sector - runStart < sectors; ++sector) {
+        if (m_usedSectors[sector]) {
+            runStart = sector + 1;
+        }
+    }
+    if (runStart + sectors > m_sectorCount) {
+        m_sectorCount = runStart + sectors;
+        m_usedSectors.resize(m_sectorCount, false);
+    }
+    std::fill_n(m_usedSectors.begin() + runStart, sectors, true);
+    return runStart;
+}
+
+void RegionFile::freeSectors(unsigned int firstSector, unsigned int sectors) {
+    if (firstSector == 0) {
+        return; // the chunk had not been saved
+    }
+    std::fill_n(m_usedSectors.begin() + firstSector, sectors, false);
+}
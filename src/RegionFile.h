@@ -0,0 +1,69 @@
+#ifndef REGION_FILE_H_INCLUDED
+#define REGION_FILE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// The saved chunks of a REGION_SIZE x REGION_SIZE area of the world, in one file. The file
+// starts with a header and a table of where each chunk's data is, and the data follows in
+// whole sectors. A chunk is always rewritten into free sectors, the new data is flushed to the
+// disk before the table that points at it is written, and the old sectors are only freed once
+// that table is flushed too. So even after a crash the file holds one whole copy of every
+// chunk. Freed sectors are reused before the file grows.
+// Chunks are read straight out of a read-only memory mapping of the file, and written in
+// batches with ordinary file writes. Not thread safe.
+class RegionFile {
+public:
+    static constexpr int REGION_SIZE = 32; // in chunks
+    static constexpr int CHUNKS_PER_REGION = REGION_SIZE * REGION_SIZE;
+
+    struct ChunkWrite {
+        int m_localX, m_localZ;
+        const std::vector<unsigned char>* m_data;
+    };
+
+private:
+    static constexpr std::size_t SECTOR_SIZE = 4096;
+    static constexpr std::size_t HEADER_SIZE = 8;                         // magic number and version
+    static constexpr std::size_t TABLE_SIZE = CHUNKS_PER_REGION * 8;      // a sector and a size per chunk
+    static constexpr unsigned int FIRST_SECTOR = static_cast<unsigned int>((HEADER_SIZE + TABLE_SIZE + SECTOR_SIZE - 1) / SECTOR_SIZE);
+
+    struct TableEntry {
+        unsigned int m_sector;  // 0 if the chunk has not been saved
+        unsigned int m_size;    // in bytes
+        unsigned int m_sectors; // the sectors allocated to the chunk (not saved in the file)
+    };
+
+    std::string m_path;
+    TableEntry m_table[CHUNKS_PER_REGION];
+    unsigned int m_sectorCount;      // the sectors in the file, including the header
+    std::vector<bool> m_usedSectors; // one per sector in the file, rebuilt from the table when it is opened
+    const unsigned char* m_mapping;
+    std::size_t m_mappingSize;
+
+public:
+    RegionFile(const std::string& path);
+    ~RegionFile();
+    RegionFile(const RegionFile&) = delete;
+    RegionFile& operator=(const RegionFile&) = delete;
+
+    // points data at the chunk's bytes in the mapped file, which stay valid until the next write.
+    // returns false if the chunk is not in the file
+    bool read(int localX, int localZ, const unsigned char*& data, std::size_t& size);
+    // writes every chunk in writes with one write call per run of consecutive sectors and one
+    // for the table, flushing the file before and after the table. if it fails, the chunks
+    // keep their old data
+    bool write(const std::vector<ChunkWrite>& writes);
+    // waits until everything written to the file has reached the disk
+    bool sync();
+
+private:
+    bool map();
+    void unmap();
+    void readTable();
+    unsigned int allocateSectors(unsigned int sectors);
+    void freeSectors(unsigned int firstSector, unsigned int sectors);
+};
+
+#endif
@@ -11,6 +11,8 @@
 #include <vector>
 #include <unordered_map>
 
+unsigned int ShaderProgram::s_boundProgramID = 0;
+
 ShaderProgram::Shader::Shader(unsigned int id, const std::string& source)
     : m_id{ id }, m_source{ source } {}
 
@@ -27,6 +29,9 @@ ShaderProgram::ShaderProgram(const std::string& vertexFilePath, const std::strin
 }
 
 ShaderProgram::~ShaderProgram() {
+    if (s_boundProgramID == m_shaderProgramID) {
+        s_boundProgramID = 0;
+    }
     glDeleteProgram(m_shaderProgramID);
 }
 
@@ -74,11 +79,15 @@ std::string ShaderProgram::parseShader(const std::string& filePath) const {
 }
 
 void ShaderProgram::bind() const {
-    glUseProgram(m_shaderProgramID);
+    if (s_boundProgramID != m_shaderProgramID) {
+        glUseProgram(m_shaderProgramID);
+        s_boundProgramID = m_shaderProgramID;
+    }
 }
 
 void ShaderProgram::unbind() const {
     glUseProgram(0);
+    s_boundProgramID = 0;
 }
 
 void ShaderProgram::addTexture(const Texture* texture, const std::string& name) {
@@ -122,6 +131,15 @@ void ShaderProgram::addUniformMat4f(const std::string& name, const glm::mat4& ma
     glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
+void ShaderProgram::bindUniformBlock(const std::string& name, unsigned int bindingPoint) {
+    unsigned int index = glGetUniformBlockIndex(m_shaderProgramID, name.c_str());
+    if (index == GL_INVALID_INDEX) {
+        std::cerr << "The Uniform Block " + name + " does not exist!\n";
+        return;
+    }
+    glUniformBlockBinding(m_shaderProgramID, index, bindingPoint);
+}
+
 int ShaderProgram::getUniformLocation(const std::string& name) {
     auto cachedLocation = m_uniformLocationCache.find(name);
     if (cachedLocation != m_uniformLocationCache.end()) {
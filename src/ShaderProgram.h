@@ -21,6 +21,9 @@ class ShaderProgram {
     std::vector<ShaderProgram::Shader> m_shaders;
     std::unordered_map<std::string, int> m_uniformLocationCache;
 
+    // the program currently in use, so binding it again doesn't call glUseProgram
+    static unsigned int s_boundProgramID;
+
 public:
     ShaderProgram(const std::string& vertexFilePath, const std::string& fragmentFilePath);
     ~ShaderProgram();
@@ -36,6 +39,7 @@ public:
     void addUniform3f(const std::string& name, float v0, float v1, float v2);
     void addUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
     void addUniformMat4f(const std::string& name, const glm::mat4& matrix);
+    void bindUniformBlock(const std::string& name, unsigned int bindingPoint);
 
 private:
     void compileAndLink() const;
@@ -0,0 +1,221 @@
+#include "TerrainGenerator.h"
+#include "Chunk.h"
+#include "BatchNoise.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+// the different features of a chunk get different random numbers
+static constexpr unsigned int CAVE_FEATURE = 1;
+static constexpr unsigned int ORE_FEATURE = 2;
+static constexpr unsigned int BOULDER_FEATURE = 3;
+
+static constexpr float PI = 3.14159265f;
+
+// the caves stay below the lowest ground of the heightmap (the base height), so they only break
+// the surface where density layers bring it down
+static constexpr float CAVE_CHANCE = 0.5f; // per chunk
+static constexpr float CAVE_MIN_Y = 6.0f;
+static constexpr float CAVE_MAX_Y = 40.0f;
+static constexpr int ORE_POCKETS_PER_CHUNK = 6;
+static constexpr float BOULDER_CHANCE = 0.3f;
+
+// the lattice points the density noise is sampled at, which include both ends of the chunk
+static constexpr int POINTS_X = CHUNK_LENGTH / TerrainGenerator::LATTICE_X + 1;
+static constexpr int POINTS_Y = CHUNK_HEIGHT / TerrainGenerator::LATTICE_Y + 1;
+static constexpr int POINTS_Z = CHUNK_WIDTH / TerrainGenerator::LATTICE_Z + 1;
+static constexpr int LATTICE_POINTS = POINTS_X * POINTS_Y * POINTS_Z;
+
+static_assert(CHUNK_LENGTH % TerrainGenerator::LATTICE_X == 0 && CHUNK_HEIGHT % TerrainGenerator::LATTICE_Y == 0 &&
+    CHUNK_WIDTH % TerrainGenerator::LATTICE_Z == 0, "the lattice must line up with the chunk");
+
+std::vector<TerrainGenerator::LayerSettings> TerrainGenerator::getDefaultLayers() {
+    return { { 0.01f, 3, 2.0f, 0.5f, 30.0f } };
+}
+
+std::vector<TerrainGenerator::LayerSettings> TerrainGenerator::getDefaultDensityLayers() {
+    // steep enough (in y) to make overhangs
+    return { { 0.02f, 2, 2.0f, 0.5f, 24.0f } };
+}
+
+TerrainGenerator::TerrainGenerator(int seed, float baseHeight, const std::vector<LayerSettings>& layers,
+    const std::vector<LayerSettings>& densityLayers) : m_seed{ seed }, m_baseHeight{ baseHeight } {
+    // the permutation tables are built once here, instead of for every chunk
+    m_layers.reserve(layers.size());
+    for (const LayerSettings& layer : layers) {
+        BatchNoise noise(seed++, layer.m_frequency, layer.m_octaves, layer.m_lacunarity, layer.m_gain);
+        m_layers.push_back(Layer{ noise, layer.m_height });
+    }
+    m_densityLayers.reserve(densityLayers.size());
+    for (const LayerSettings& layer : densityLayers) {
+        BatchNoise noise(seed++, layer.m_frequency, layer.m_octaves, layer.m_lacunarity, layer.m_gain);
+        m_densityLayers.push_back(Layer{ noise, layer.m_height });
+    }
+}
+
+bool TerrainGenerator::hasDensity() const {
+    return !m_densityLayers.empty();
+}
+
+void TerrainGenerator::getGroundHeights(float chunkX, float chunkZ, int heights[CHUNK_LENGTH][CHUNK_WIDTH]) const {
+    double height[CHUNK_LENGTH][CHUNK_WIDTH];
+    getHeights(chunkX, chunkZ, height);
+    for (int x = 0; x < CHUNK_LENGTH; ++x) {
+        for (int z = 0; z < CHUNK_WIDTH; ++z) {
+            heights[x][z] = static_cast<int>(height[x][z]);
+        }
+    }
+}
+
+void TerrainGenerator::getSolidBlocks(float chunkX, float chunkZ, unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH]) const {
+    // the sum of the density layers at each lattice point, [x][y][z]
+    float x[LATTICE_POINTS], y[LATTICE_POINTS], z[LATTICE_POINTS], noise[LATTICE_POINTS];
+    for (int point = 0; point < LATTICE_POINTS; ++point) {
+        x[point] = CHUNK_LENGTH * chunkX + static_cast<float>(point / (POINTS_Y * POINTS_Z) * LATTICE_X);
+        y[point] = static_cast<float>(point / POINTS_Z % POINTS_Y * LATTICE_Y);
+        z[point] = CHUNK_WIDTH * chunkZ + static_cast<float>(point % POINTS_Z * LATTICE_Z);
+    }
+    float lattice[POINTS_X][POINTS_Y][POINTS_Z] = {};
+    for (const Layer& layer : m_densityLayers) {
+        layer.m_noise.getSimplexFractal(x, y, z, LATTICE_POINTS, noise);
+        for (int point = 0; point < LATTICE_POINTS; ++point) {
+            (&lattice[0][0][0])[point] += noise[point] * layer.m_height;
+        }
+    }
+
+    // Without density a block is solid up to the ground height, so it is solid while y is below
+    // the surface one above that. The density moves the surface up or down.
+    double height[CHUNK_LENGTH][CHUNK_WIDTH];
+    getHeights(chunkX, chunkZ, height);
+    for (int X = 0; X < CHUNK_LENGTH; ++X) {
+        float surface[CHUNK_WIDTH];
+        for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
+            surface[Z] = static_cast<float>(static_cast<int>(height[X][Z]) + 1);
+        }
+        // interpolate the lattice along x, then along z, at every lattice level, for this row of
+        // the chunk. the loops over a row of z are simple enough for the compiler to vectorize
+        const int pointX = X / LATTICE_X;
+        const float fractionX = static_cast<float>(X % LATTICE_X) / LATTICE_X;
+        float levels[POINTS_Y][CHUNK_WIDTH];
+        float lowest = static_cast<float>(CHUNK_HEIGHT), highest = 0.0f;
+        for (int pointY = 0; pointY < POINTS_Y; ++pointY) {
+            float alongX[POINTS_Z];
+            for (int pointZ = 0; pointZ < POINTS_Z; ++pointZ) {
+                float low = lattice[pointX][pointY][pointZ], high = lattice[pointX + 1][pointY][pointZ];
+                alongX[pointZ] = low + (high - low) * fractionX;
+            }
+            for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
+                float low = alongX[Z / LATTICE_Z], high = alongX[Z / LATTICE_Z + 1];
+                levels[pointY][Z] = surface[Z] + low + (high - low) * (static_cast<float>(Z % LATTICE_Z) / LATTICE_Z);
+            }
+            for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
+                lowest = std::min(lowest, levels[pointY][Z]);
+                highest = std::max(highest, levels[pointY][Z]);
+            }
+        }
+        // and along y between the levels. the values in between never go past the levels, so
+        // only the rows between the lowest and highest level need to be interpolated
+        for (int Y = 0; Y < CHUNK_HEIGHT; ++Y) {
+            const float row = static_cast<float>(Y);
+            if (row < lowest || row >= highest) {
+                std::fill_n(solid[X][Y], CHUNK_WIDTH, row < lowest ? 1 : 0);
+                continue;
+            }
+            const float* low = levels[Y / LATTICE_Y];
+            const float* high = levels[Y / LATTICE_Y + 1];
+            const float fractionY = static_cast<float>(Y % LATTICE_Y) / LATTICE_Y;
+            for (int Z = 0; Z < CHUNK_WIDTH; ++Z) {
+                solid[X][Y][Z] = row < low[Z] + (high[Z] - low[Z]) * fractionY ? 1 : 0;
+            }
+        }
+    }
+}
+
+void TerrainGenerator::getHeights(float chunkX, float chunkZ, double height[CHUNK_LENGTH][CHUNK_WIDTH]) const {
+    for (int x = 0; x < CHUNK_LENGTH; ++x) {
+        for (int z = 0; z < CHUNK_WIDTH; ++z) {
+            height[x][z] = m_baseHeight;
+        }
+    }
+    float noise[CHUNK_WIDTH][CHUNK_LENGTH];
+    for (const Layer& layer : m_layers) {
+        layer.m_noise.getSimplexFractalGrid(CHUNK_LENGTH * chunkX, CHUNK_WIDTH * chunkZ, CHUNK_LENGTH, CHUNK_WIDTH, &noise[0][0]);
+        for (int x = 0; x < CHUNK_LENGTH; ++x) {
+            for (int z = 0; z < CHUNK_WIDTH; ++z) {
+                // the noise is from -1 to 1
+                height[x][z] += (noise[z][x] + 1.0) / 2.0 * layer.m_height;
+            }
+        }
+    }
+}
+
+void TerrainGenerator::getCaves(int chunkX, int chunkZ, std::vector<Sphere>& spheres) const {
+    std::minstd_rand random(getFeatureSeed(chunkX, chunkZ, CAVE_FEATURE));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    if (unit(random) >= CAVE_CHANCE) {
+        return;
+    }
+    // a tunnel that wanders off from a random point in the chunk, as a row of overlapping spheres
+    float x = (chunkX + unit(random)) * CHUNK_LENGTH;
+    float y = CAVE_MIN_Y + unit(random) * (CAVE_MAX_Y - CAVE_MIN_Y);
+    float z = (chunkZ + unit(random)) * CHUNK_WIDTH;
+    float yaw = unit(random) * 2.0f * PI;
+    float pitch = (unit(random) - 0.5f) * 0.5f;
+    int length = 24 + static_cast<int>(unit(random) * 48.0f);
+
+    const float minX = static_cast<float>(chunkX * CHUNK_LENGTH - FEATURE_REACH), maxX = static_cast<float>((chunkX + 1) * CHUNK_LENGTH + FEATURE_REACH);
+    const float minZ = static_cast<float>(chunkZ * CHUNK_WIDTH - FEATURE_REACH), maxZ = static_cast<float>((chunkZ + 1) * CHUNK_WIDTH + FEATURE_REACH);
+    for (int step = 0; step < length; ++step) {
+        // widest in the middle
+        float radius = 1.5f + 1.5f * std::sin(PI * step / length);
+        if (x - radius < minX || x + radius > maxX || z - radius < minZ || z + radius > maxZ) {
+            break;
+        }
+        spheres.push_back(Sphere{ x, y, z, radius });
+        x += std::cos(yaw) * std::cos(pitch);
+        z += std::sin(yaw) * std::cos(pitch);
+        y = std::min(std::max(y + std::sin(pitch), CAVE_MIN_Y), CAVE_MAX_Y);
+        yaw += (unit(random) - 0.5f) * 0.6f;
+        pitch = pitch * 0.7f + (unit(random) - 0.5f) * 0.3f;
+    }
+}
+
+void TerrainGenerator::getOrePockets(int chunkX, int chunkZ, std::vector<Sphere>& spheres) const {
+    std::minstd_rand random(getFeatureSeed(chunkX, chunkZ, ORE_FEATURE));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int pocket = 0; pocket < ORE_POCKETS_PER_CHUNK; ++pocket) {
+        float x = (chunkX + unit(random)) * CHUNK_LENGTH;
+        float y = 4.0f + unit(random) * 40.0f;
+        float z = (chunkZ + unit(random)) * CHUNK_WIDTH;
+        spheres.push_back(Sphere{ x, y, z, 1.0f + unit(random) * 1.5f });
+    }
+}
+
+void TerrainGenerator::getBoulders(int chunkX, int chunkZ, const unsigned char heights[CHUNK_LENGTH][CHUNK_WIDTH], std::vector<Sphere>& spheres) const {
+    std::minstd_rand random(getFeatureSeed(chunkX, chunkZ, BOULDER_FEATURE));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    if (unit(random) >= BOULDER_CHANCE) {
+        return;
+    }
+    int column = static_cast<int>(unit(random) * CHUNK_LENGTH * CHUNK_WIDTH) % (CHUNK_LENGTH * CHUNK_WIDTH);
+    int x = column / CHUNK_WIDTH, z = column % CHUNK_WIDTH;
+    float radius = 1.5f + unit(random) * 1.5f;
+    // half buried in the ground
+    spheres.push_back(Sphere{ chunkX * CHUNK_LENGTH + x + 0.5f, heights[x][z] + 1.0f, chunkZ * CHUNK_WIDTH + z + 0.5f, radius });
+}
+
+unsigned int TerrainGenerator::getFeatureSeed(int chunkX, int chunkZ, unsigned int feature) const {
+    // every feature of every chunk seeds its own random number generator, which is why the
+    // features use std::minstd_rand (std::mt19937 fills in 624 words before its first number)
+    // mix the numbers together so that nearby chunks get unrelated seeds
+    unsigned int hash = static_cast<unsigned int>(m_seed) * 0x9E3779B9u;
+    hash ^= static_cast<unsigned int>(chunkX) * 0x85EBCA6Bu + (hash << 6) + (hash >> 2);
+    hash ^= static_cast<unsigned int>(chunkZ) * 0xC2B2AE35u + (hash << 6) + (hash >> 2);
+    hash ^= feature * 0x27D4EB2Fu + (hash << 6) + (hash >> 2);
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    return hash;
+}
@@ -0,0 +1,91 @@
+#ifndef TERRAIN_GENERATOR_H_INCLUDED
+#define TERRAIN_GENERATOR_H_INCLUDED
+
+#include "Chunk.h"
+#include "BatchNoise.h"
+
+#include <vector>
+
+// Decides the shape of the terrain from the world's seed. The ground height is the sum of one
+// or more layers of noise, each scaled to its own range of heights. It is only read once it
+// has been constructed, so one generator is shared by every chunk and every worker thread.
+//
+// With density layers, layers of 3D noise also move the ground up or down at every block, so
+// the terrain gets overhangs and floating bits. Evaluating 3D noise for every block would cost
+// far too much, so it is sampled on a lattice of points LATTICE_X x LATTICE_Y x LATTICE_Z blocks
+// apart and interpolated in between.
+//
+// A chunk is generated in stages (see Chunk::generateStage). The features added by the later
+// stages (caves, pockets of dirt and boulders) belong to the chunk they start in, but can
+// reach up to FEATURE_REACH blocks into the chunks around it. Each chunk adds the parts of
+// the features of the 3x3 chunks around it that fall inside it. The features only depend on
+// the seed and the chunk they start in (and for boulders, the ground heights found by that
+// chunk's first stage), so every chunk they cross agrees on where they are.
+class TerrainGenerator {
+public:
+    enum Stage {
+        HEIGHTMAP,   // the ground height of every column (with density layers, also the blocks, which they come from)
+        SURFACE,     // stone, then dirt, then grass up to the ground height (nothing left to do with density layers)
+        CAVES,       // tunnels carved through the stone
+        ORES,        // pockets of dirt in the stone
+        DECORATIONS, // boulders on the ground
+        STAGE_COUNT
+    };
+
+    static constexpr int FEATURE_REACH = CHUNK_LENGTH; // in blocks, so only the chunks next to a feature's chunk can be touched
+    static constexpr int LATTICE_X = 4, LATTICE_Y = 8, LATTICE_Z = 4;  // in blocks
+
+    struct LayerSettings {
+        float m_frequency;
+        int m_octaves;
+        float m_lacunarity;
+        float m_gain;
+        float m_height; // the layer adds between 0 and m_height blocks to the ground height (a density layer -m_height to m_height)
+    };
+
+    // a ball of blocks, in world block coordinates
+    struct Sphere {
+        float m_x, m_y, m_z;
+        float m_radius;
+    };
+
+    // one layer with FastNoise's default settings
+    static std::vector<LayerSettings> getDefaultLayers();
+    static std::vector<LayerSettings> getDefaultDensityLayers();
+
+private:
+    struct Layer {
+        BatchNoise m_noise;
+        float m_height;
+    };
+
+    int m_seed;
+    std::vector<Layer> m_layers;
+    std::vector<Layer> m_densityLayers;
+    float m_baseHeight; // the ground height where every layer is at its lowest
+
+public:
+    // each layer gets its own seed, counting up from seed. without density layers the terrain is a heightmap
+    TerrainGenerator(int seed, float baseHeight = 50.0f, const std::vector<LayerSettings>& layers = getDefaultLayers(),
+        const std::vector<LayerSettings>& densityLayers = {});
+
+    bool hasDensity() const;
+    // fills heights[x][z] with the height of the top (grass) block of each column of the chunk at
+    // (chunkX, chunkZ), leaving out the density layers
+    void getGroundHeights(float chunkX, float chunkZ, int heights[CHUNK_LENGTH][CHUNK_WIDTH]) const;
+    // sets solid[x][y][z] to 1 for every block of the chunk at (chunkX, chunkZ) that is below the
+    // ground, moved up or down by the density layers, and to 0 for the rest
+    void getSolidBlocks(float chunkX, float chunkZ, unsigned char solid[CHUNK_LENGTH][CHUNK_HEIGHT][CHUNK_WIDTH]) const;
+
+    // these add the spheres of the features that start in the chunk at (chunkX, chunkZ) to spheres
+    void getCaves(int chunkX, int chunkZ, std::vector<Sphere>& spheres) const;
+    void getOrePockets(int chunkX, int chunkZ, std::vector<Sphere>& spheres) const;
+    // heights are the chunk's ground heights
+    void getBoulders(int chunkX, int chunkZ, const unsigned char heights[CHUNK_LENGTH][CHUNK_WIDTH], std::vector<Sphere>& spheres) const;
+
+private:
+    void getHeights(float chunkX, float chunkZ, double height[CHUNK_LENGTH][CHUNK_WIDTH]) const;
+    unsigned int getFeatureSeed(int chunkX, int chunkZ, unsigned int feature) const;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef THREAD_POOL_H_INCLUDED
+#define THREAD_POOL_H_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool {
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+
+public:
+    ThreadPool(unsigned int threadCount);
+    ~ThreadPool();
+
+    void submit(std::function<void()> job);
+    void stop();
+    unsigned int getThreadCount() const;
+
+private:
+    void workerLoop();
+};
+
+#endif
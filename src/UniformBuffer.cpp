@@ -0,0 +1,25 @@
+#include "UniformBuffer.h"
+
+#include <glad/glad.h>
+
+UniformBuffer::UniformBuffer(unsigned int size, unsigned int bindingPoint) : m_bindingPoint{ bindingPoint } {
+    // allocate the buffer and attach it to its binding point. Every shader program whose
+    // uniform block is bound to the same binding point will read from this buffer.
+    glGenBuffers(1, &m_uniformBufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBufferID);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, m_bindingPoint, m_uniformBufferID);
+}
+
+UniformBuffer::~UniformBuffer() {
+    glDeleteBuffers(1, &m_uniformBufferID);
+}
+
+void UniformBuffer::setData(unsigned int offset, unsigned int size, const void* data) const {
+    glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBufferID);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+}
+
+unsigned int UniformBuffer::getBindingPoint() const {
+    return m_bindingPoint;
+}
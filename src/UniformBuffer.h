@@ -0,0 +1,16 @@
+#ifndef UNIFORM_BUFFER_H_INCLUDED
+#define UNIFORM_BUFFER_H_INCLUDED
+
+class UniformBuffer {
+    unsigned int m_uniformBufferID;
+    unsigned int m_bindingPoint;
+
+public:
+    UniformBuffer(unsigned int size, unsigned int bindingPoint);
+    ~UniformBuffer();
+
+    void setData(unsigned int offset, unsigned int size, const void* data) const;
+    unsigned int getBindingPoint() const;
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include "VertexArena.h"
+#include "ShaderProgram.h"
+#include "BlockInfo.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+
+VertexArena::VertexArena(unsigned int textureSlot, unsigned int initialPages)
+    : m_textureSlot{ textureSlot }, m_capacity{ initialPages }, m_usedPages{ 0 }, m_rebuilds{ 0 },
+    m_pageOffsets(initialPages, glm::vec4(0.0f)), m_lastDrawRanges{ 0 }, m_indexBufferFaces{ 0 } {
+    glGenVertexArrays(1, &m_vertexArrayID);
+    glGenBuffers(1, &m_vertexBufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<std::size_t>(m_capacity) * PAGE_BYTES, nullptr, GL_DYNAMIC_DRAW);
+    attachVertexBuffer();
+
+    // attach the index buffer to the vertex array (it is filled by reserveIndices)
+    glGenBuffers(1, &m_indexBufferID);
+    glBindVertexArray(m_vertexArrayID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
+
+    // the page positions are read in the shader as a samplerBuffer of vec4s
+    glGenBuffers(1, &m_pageBufferID);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_pageBufferID);
+    glBufferData(GL_TEXTURE_BUFFER, m_pageOffsets.size() * sizeof(glm::vec4), m_pageOffsets.data(), GL_DYNAMIC_DRAW);
+    glGenTextures(1, &m_pageTextureID);
+    glActiveTexture(GL_TEXTURE0 + m_textureSlot);
+    glBindTexture(GL_TEXTURE_BUFFER, m_pageTextureID);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_pageBufferID);
+
+    m_freeRuns[0] = m_capacity;
+}
+
+VertexArena::~VertexArena() {
+    glDeleteVertexArrays(1, &m_vertexArrayID);
+    glDeleteBuffers(1, &m_vertexBufferID);
+    glDeleteBuffers(1, &m_indexBufferID);
+    glDeleteBuffers(1, &m_pageBufferID);
+    glDeleteTextures(1, &m_pageTextureID);
+}
+
+void VertexArena::attachVertexBuffer() const {
+    // tell openGL the layout of our vertex data (the vertex array remembers the buffer it came from)
+    glBindVertexArray(m_vertexArrayID);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(unsigned int), 0);
+}
+
+VertexArena::Handle VertexArena::allocate(Handle handle, unsigned int size, const void* data, const unsigned int* faceCounts, const glm::vec3& chunkOffset) {
+    if (size == 0) {
+        release(handle);
+        return NO_ALLOCATION;
+    }
+    unsigned int faceCount = size / Block::BYTES_PER_FACE;
+    unsigned int pages = (faceCount + PAGE_FACES - 1) / PAGE_FACES;
+
+    // a mesh keeps its pages while the new data fits in them, and gives back the ones at the
+    // end it no longer needs. otherwise it moves to a new run
+    if (handle == NO_ALLOCATION) {
+        if (!m_freeHandles.empty()) {
+            handle = m_freeHandles.back();
+            m_freeHandles.pop_back();
+        } else {
+            handle = static_cast<Handle>(m_allocations.size());
+            m_allocations.push_back(Allocation{});
+        }
+    } else if (pages <= m_allocations[handle].m_pages) {
+        Allocation& allocation = m_allocations[handle];
+        if (pages < allocation.m_pages) {
+            returnPages(allocation.m_firstPage + pages, allocation.m_pages - pages);
+            allocation.m_pages = pages;
+        }
+    } else {
+        returnPages(m_allocations[handle].m_firstPage, m_allocations[handle].m_pages);
+        m_allocations[handle].m_pages = 0;
+    }
+    if (m_allocations[handle].m_pages == 0) {
+        // taking the pages can rebuild the buffer, which moves the other allocations
+        unsigned int firstPage = takePages(pages);
+        m_allocations[handle].m_firstPage = firstPage;
+        m_allocations[handle].m_pages = pages;
+    }
+
+    Allocation& allocation = m_allocations[handle];
+    allocation.m_faceCount = faceCount;
+    std::copy_n(faceCounts, Block::FACES_PER_BLOCK, allocation.m_faceCounts);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<std::size_t>(allocation.m_firstPage) * PAGE_BYTES, size, data);
+    std::fill_n(m_pageOffsets.begin() + allocation.m_firstPage, pages, glm::vec4(chunkOffset, 0.0f));
+    uploadPageOffsets(allocation.m_firstPage, pages);
+    reserveIndices(faceCount);
+    return handle;
+}
+
+void VertexArena::release(Handle handle) {
+    if (handle == NO_ALLOCATION) {
+        return;
+    }
+    returnPages(m_allocations[handle].m_firstPage, m_allocations[handle].m_pages);
+    m_allocations[handle].m_pages = 0;
+    m_freeHandles.push_back(handle);
+}
+
+void VertexArena::draw(Handle handle, unsigned int faceMask) {
+    m_queuedDraws.emplace_back(handle, faceMask);
+}
+
+void VertexArena::render(const ShaderProgram* shader) {
+    // Each run of neighboring face groups in a mesh's faceMask is one range of the index
+    // buffer. A range starting at face f starts at index f * INDICES_PER_FACE, and its indices
+    // are counted from the mesh's first vertex, which is passed as the range's base vertex.
+    m_drawCounts.clear();
+    m_drawOffsets.clear();
+    m_drawBaseVertices.clear();
+    for (const std::pair<Handle, unsigned int>& queued : m_queuedDraws) {
+        const Allocation& allocation = m_allocations[queued.first];
+        unsigned int firstFace = 0, rangeEnd = 0;
+        bool inRange = false;
+        for (unsigned int face = 0; face < Block::FACES_PER_BLOCK; ++face) {
+            if ((queued.second >> face) & 1 && allocation.m_faceCounts[face] > 0) {
+                if (!inRange || rangeEnd != firstFace) {
+                    m_drawOffsets.push_back(reinterpret_cast<const void*>(static_cast<std::size_t>(firstFace) * Block::INDICES_PER_FACE * sizeof(unsigned int)));
+                    m_drawCounts.push_back(0);
+                    m_drawBaseVertices.push_back(static_cast<int>(allocation.m_firstPage * PAGE_VERTICES));
+                    inRange = true;
+                }
+                m_drawCounts.back() += static_cast<int>(allocation.m_faceCounts[face] * Block::INDICES_PER_FACE);
+                rangeEnd = firstFace + allocation.m_faceCounts[face];
+            }
+            firstFace += allocation.m_faceCounts[face];
+        }
+    }
+    m_queuedDraws.clear();
+    m_lastDrawRanges = m_drawCounts.size();
+    if (m_drawCounts.empty()) {
+        return;
+    }
+    shader->bind();
+    glActiveTexture(GL_TEXTURE0 + m_textureSlot);
+    glBindTexture(GL_TEXTURE_BUFFER, m_pageTextureID);
+    glBindVertexArray(m_vertexArrayID);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_INT, m_drawOffsets.data(),
+        static_cast<GLsizei>(m_drawCounts.size()), m_drawBaseVertices.data());
+}
+
+std::size_t VertexArena::getAllocationSize(Handle handle) const {
+    return handle == NO_ALLOCATION ? 0 : static_cast<std::size_t>(m_allocations[handle].m_pages) * PAGE_BYTES;
+}
+
+std::size_t VertexArena::getMemoryUsage() const {
+    // the vertex buffer, the page positions and the index buffer on the GPU
+    return static_cast<std::size_t>(m_capacity) * (PAGE_BYTES + sizeof(glm::vec4))
+        + static_cast<std::size_t>(m_indexBufferFaces) * Block::INDICES_PER_FACE * sizeof(unsigned int);
+}
+
+void VertexArena::printStats() const {
+    unsigned int largestRun = 0;
+    for (const auto& [firstPage, pages] : m_freeRuns) {
+        largestRun = std::max(largestRun, pages);
+    }
+    std::cout << "Vertex arena: " << m_usedPages << " of " << m_capacity << " pages used (" << PAGE_BYTES << " bytes each) by "
+        << m_allocations.size() - m_freeHandles.size() << " meshes, " << m_freeRuns.size() << " free runs (largest "
+        << largestRun << " pages), rebuilt " << m_rebuilds << " times, last frame drew " << m_lastDrawRanges << " ranges in one call\n";
+}
+
+unsigned int VertexArena::takePages(unsigned int pages) {
+    // the first free run that is large enough
+    for (auto it = m_freeRuns.begin(); it != m_freeRuns.end(); ++it) {
+        if (it->second >= pages) {
+            unsigned int firstPage = it->first;
+            unsigned int left = it->second - pages;
+            m_freeRuns.erase(it);
+            if (left > 0) {
+                m_freeRuns[firstPage + pages] = left;
+            }
+            m_usedPages += pages;
+            return firstPage;
+        }
+    }
+
+    // Compact, doubling the size of the buffer if it would be more than half full (and more
+    // for a mesh larger than the whole buffer). Afterwards all of the free pages are in one
+    // run at the end, which fits the pages.
+    unsigned int capacity = std::max(m_capacity, 1u);
+    if (2 * (m_usedPages + pages) > capacity) {
+        capacity *= 2;
+    }
+    while (m_usedPages + pages > capacity) {
+        capacity *= 2;
+    }
+    rebuild(capacity);
+    return takePages(pages);
+}
+
+void VertexArena::returnPages(unsigned int firstPage, unsigned int pages) {
+    if (pages == 0) {
+        return;
+    }
+    m_usedPages -= pages;
+
+    // merge the run with the free runs right after and before it
+    auto next = m_freeRuns.lower_bound(firstPage);
+    if (next != m_freeRuns.end() && next->first == firstPage + pages) {
+        pages += next->second;
+        next = m_freeRuns.erase(next);
+    }
+    if (next != m_freeRuns.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == firstPage) {
+            previous->second += pages;
+            return;
+        }
+    }
+    m_freeRuns.emplace_hint(next, firstPage, pages);
+}
+
+void VertexArena::rebuild(unsigned int capacity) {
+    // Copy every mesh into a new buffer of capacity pages, one after another from the start,
+    // on the GPU. The handles stay the same, only where their pages are changes.
+    unsigned int newBufferID;
+    glGenBuffers(1, &newBufferID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<std::size_t>(capacity) * PAGE_BYTES, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vertexBufferID);
+
+    std::vector<glm::vec4> pageOffsets(capacity, glm::vec4(0.0f));
+    unsigned int nextPage = 0;
+    for (Allocation& allocation : m_allocations) {
+        if (allocation.m_pages == 0) {
+            continue;
+        }
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<std::size_t>(allocation.m_firstPage) * PAGE_BYTES,
+            static_cast<std::size_t>(nextPage) * PAGE_BYTES, static_cast<std::size_t>(allocation.m_faceCount) * Block::BYTES_PER_FACE);
+        std::copy_n(m_pageOffsets.begin() + allocation.m_firstPage, allocation.m_pages, pageOffsets.begin() + nextPage);
+        allocation.m_firstPage = nextPage;
+        nextPage += allocation.m_pages;
+    }
+
+    glDeleteBuffers(1, &m_vertexBufferID);
+    m_vertexBufferID = newBufferID;
+    attachVertexBuffer();
+    m_capacity = capacity;
+    m_pageOffsets.swap(pageOffsets);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_pageBufferID);
+    glBufferData(GL_TEXTURE_BUFFER, m_pageOffsets.size() * sizeof(glm::vec4), m_pageOffsets.data(), GL_DYNAMIC_DRAW);
+
+    m_freeRuns.clear();
+    if (nextPage < m_capacity) {
+        m_freeRuns[nextPage] = m_capacity - nextPage;
+    }
+    ++m_rebuilds;
+}
+
+void VertexArena::uploadPageOffsets(unsigned int firstPage, unsigned int pages) const {
+    glBindBuffer(GL_TEXTURE_BUFFER, m_pageBufferID);
+    glBufferSubData(GL_TEXTURE_BUFFER, static_cast<std::size_t>(firstPage) * sizeof(glm::vec4), pages * sizeof(glm::vec4), &m_pageOffsets[firstPage]);
+}
+
+void VertexArena::reserveIndices(unsigned int faceCount) {
+    if (faceCount <= m_indexBufferFaces) {
+        return;
+    }
+    // grow to at least double the size so the buffer is only rebuilt a few times
+    m_indexBufferFaces = faceCount > 2 * m_indexBufferFaces ? faceCount : 2 * m_indexBufferFaces;
+
+    // each face stores its 4 corners counter-clockwise, drawn as the triangles 0-1-2 and 2-3-0
+    const unsigned int pattern[Block::INDICES_PER_FACE] = { 0, 1, 2, 2, 3, 0 };
+    std::vector<unsigned int> indices(m_indexBufferFaces * Block::INDICES_PER_FACE);
+    for (unsigned int face = 0; face < m_indexBufferFaces; ++face) {
+        for (unsigned int i = 0; i < Block::INDICES_PER_FACE; ++i) {
+            indices[face * Block::INDICES_PER_FACE + i] = face * Block::VERTICES_PER_FACE + pattern[i];
+        }
+    }
+
+    // binding the element buffer attaches it to the bound vertex array, so bind the arena's first
+    glBindVertexArray(m_vertexArrayID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+}
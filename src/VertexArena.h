@@ -0,0 +1,101 @@
+#ifndef VERTEX_ARENA_H_INCLUDED
+#define VERTEX_ARENA_H_INCLUDED
+
+#include "ShaderProgram.h"
+#include "BlockInfo.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <cstddef>
+
+// One vertex buffer shared by the meshes of every chunk, so the whole world is drawn with a
+// single call. The buffer is split into pages of PAGE_FACES faces, and each mesh gets a run
+// of whole pages from a free list. The position of the chunk a page belongs to is kept in a
+// texture buffer, which the vertex shader reads with the page of gl_VertexID (the vertex's
+// index in the buffer), so no uniform has to be set between chunks.
+//
+// When no free run is big enough, every mesh is copied to the start of a new buffer, leaving
+// all of the free pages in one run at the end. The new buffer is twice as large when the old
+// one was more than half full, so a buffer that fragmented is compacted without growing.
+// Only used on the thread that owns the OpenGL context.
+class VertexArena {
+public:
+    typedef unsigned int Handle;
+    static constexpr Handle NO_ALLOCATION = ~0u;
+
+    // must match PAGE_VERTICES in basic_vertex.glsl
+    static constexpr unsigned int PAGE_FACES = 64;
+    static constexpr unsigned int PAGE_VERTICES = PAGE_FACES * Block::VERTICES_PER_FACE;
+    static constexpr unsigned int PAGE_BYTES = PAGE_FACES * Block::BYTES_PER_FACE;
+    static constexpr unsigned int ALL_FACES = (1u << Block::FACES_PER_BLOCK) - 1;
+
+private:
+    struct Allocation {
+        unsigned int m_firstPage;
+        unsigned int m_pages;     // 0 for a free handle
+        unsigned int m_faceCount;
+        unsigned int m_faceCounts[Block::FACES_PER_BLOCK]; // the faces are stored grouped by direction, in Block::BlockFace order
+    };
+
+    unsigned int m_vertexArrayID;
+    unsigned int m_vertexBufferID;
+    unsigned int m_pageBufferID;   // the chunk position of every page, read through m_pageTextureID
+    unsigned int m_pageTextureID;
+    unsigned int m_textureSlot;
+    unsigned int m_capacity;       // in pages
+    unsigned int m_usedPages;
+    unsigned int m_rebuilds;       // the times the buffer has been compacted or grown
+    std::vector<glm::vec4> m_pageOffsets;
+    std::vector<Allocation> m_allocations;
+    std::vector<Handle> m_freeHandles;
+    std::map<unsigned int, unsigned int> m_freeRuns; // first page -> pages, never two runs next to each other
+
+    // the meshes queued by draw() for the next render(), with the ranges of the index buffer
+    // they become. the ranges are found in render, after any buffer rebuild
+    std::vector<std::pair<Handle, unsigned int>> m_queuedDraws;
+    std::vector<int> m_drawCounts;
+    std::vector<const void*> m_drawOffsets;
+    std::vector<int> m_drawBaseVertices;
+    std::size_t m_lastDrawRanges;
+
+    // every mesh draws its quads with the same index pattern from its own first vertex,
+    // so one element buffer covers them all. it is grown for the largest mesh
+    unsigned int m_indexBufferID;
+    unsigned int m_indexBufferFaces;
+
+public:
+    // the page positions are bound to textureSlot, which the shader's u_pageOffsets must use
+    VertexArena(unsigned int textureSlot, unsigned int initialPages = 4096);
+    ~VertexArena();
+    VertexArena(const VertexArena&) = delete;
+    VertexArena& operator=(const VertexArena&) = delete;
+
+    // Stores size bytes of vertex data for a mesh in the chunk at chunkOffset (in blocks).
+    // faceCounts holds the number of faces in each direction, in the order they are in data.
+    // Passing the handle of an earlier mesh replaces it, reusing its pages when the new data
+    // fits in them. Returns the handle of the mesh, or NO_ALLOCATION when size is 0 (and the
+    // earlier mesh is freed).
+    Handle allocate(Handle handle, unsigned int size, const void* data, const unsigned int* faceCounts, const glm::vec3& chunkOffset);
+    void release(Handle handle);
+    // queues the faces of the directions in faceMask (bit i is Block::BlockFace i) to be drawn
+    void draw(Handle handle, unsigned int faceMask = ALL_FACES);
+    // draws everything queued since the last render in one call
+    void render(const ShaderProgram* shader);
+    // the bytes of the buffer taken by a mesh (whole pages)
+    std::size_t getAllocationSize(Handle handle) const;
+    std::size_t getMemoryUsage() const;
+    void printStats() const;
+
+private:
+    void attachVertexBuffer() const;
+    unsigned int takePages(unsigned int pages);
+    void returnPages(unsigned int firstPage, unsigned int pages);
+    void rebuild(unsigned int capacity);
+    void uploadPageOffsets(unsigned int firstPage, unsigned int pages) const;
+    void reserveIndices(unsigned int faceCount);
+};
+
+#endif
@@ -0,0 +1,590 @@
+#include "World.h"
+#include "Chunk.h"
+#include "BlockInfo.h"
+#include "ShaderProgram.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+#include "LockFreeQueue.h"
+#include "BatchNoise.h"
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <chrono>
+
+// how many generation and meshing jobs may be queued or running per worker thread
+static constexpr int MAX_JOBS_PER_THREAD = 4;
+
+// Uploading a mesh copies its vertex data into driver memory, and many of them finishing at
+// once would spike the frame time. Uploads stop for the frame once either budget is used up.
+static constexpr std::size_t UPLOAD_BYTES_PER_FRAME = 4 * 1024 * 1024;
+static constexpr double UPLOAD_SECONDS_PER_FRAME = 0.002;
+
+// edited chunks are also saved while they stay loaded, so a crash loses at most this much
+static constexpr std::chrono::seconds AUTOSAVE_INTERVAL(10);
+
+// one thread is left for the main (OpenGL) thread
+static unsigned int workerThreadCount() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+// the offset to the neighbor in each direction and the direction back from that neighbor
+static constexpr int NEIGHBOR_OFFSETS[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+static constexpr Chunk::Direction OPPOSITE[4] = { Chunk::MINUS_X, Chunk::PLUS_X, Chunk::MINUS_Z, Chunk::PLUS_Z };
+
+// the offset to the next chunk (x, z) and section (y) through each side of a section, in
+// Block::BlockFace order. the side opposite side is side ^ 1
+static constexpr int SIDE_OFFSETS[Block::FACES_PER_BLOCK][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+// A chunk that is drawn needs its four neighbors generated to be meshed, and a chunk can only
+// run a generation stage once the eight chunks around it have finished the stage before. So
+// every chunk that is drawn needs chunks loaded one ring past the render distance, and one more
+// ring out for every stage after the first. Each ring around a chunk reaches up to sqrt(2)
+// chunks further out at its corners.
+static int getLoadDistance(int renderDistance) {
+    return renderDistance + 1 + static_cast<int>(std::ceil((TerrainGenerator::STAGE_COUNT - 1) * std::sqrt(2.0)));
+}
+
+static long long chunkKey(int x, int z) {
+    // shifted as unsigned, since shifting a negative value is undefined
+    return static_cast<long long>((static_cast<unsigned long long>(static_cast<unsigned int>(x)) << 32) | static_cast<unsigned int>(z));
+}
+
+static int keyX(long long key) {
+    return static_cast<int>(key >> 32);
+}
+
+static int keyZ(long long key) {
+    return static_cast<int>(static_cast<unsigned int>(key));
+}
+
+// division that rounds towards negative infinity, to find the chunk holding a block
+static int floorDiv(int a, int b) {
+    return a / b - (a % b < 0 ? 1 : 0);
+}
+
+World::World(ShaderProgram* shader, int renderDistance, std::size_t memoryBudget, const std::string& saveDirectory, const TerrainGenerator& terrain)
+    : m_arena{ PAGE_OFFSETS_SLOT }, m_shader{ shader }, m_renderDistance{ renderDistance }, m_loadDistance{ getLoadDistance(renderDistance) }, m_memoryBudget{ memoryBudget }, m_memoryUsage{ 0 },
+    m_cameraPosition{ 0.0f }, m_cameraChunkX{ 0 }, m_cameraChunkZ{ 0 }, m_chunksDrawn{ 0 }, m_chunksCulled{ 0 }, m_sectionsDrawn{ 0 },
+    m_occlusionCulling{ true }, m_jobsInFlight{ 0 },
+    m_bytesUploaded{ 0 }, m_sectionsRemeshed{ 0 }, m_lastAutosave{ std::chrono::steady_clock::now() },
+    m_terrain{ terrain }, m_io{ saveDirectory }, m_threadPool{ workerThreadCount() } {
+    for (int x = -m_loadDistance; x <= m_loadDistance; ++x) {
+        for (int z = -m_loadDistance; z <= m_loadDistance; ++z) {
+            if (x * x + z * z <= m_loadDistance * m_loadDistance) {
+                m_loadOrder.emplace_back(x, z);
+            }
+        }
+    }
+    std::sort(m_loadOrder.begin(), m_loadOrder.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        return a.first * a.first + a.second * a.second < b.first * b.first + b.second * b.second;
+    });
+}
+
+World::~World() {
+    // the loads and jobs still running may be using the chunks, so wait for them first
+    m_io.cancelLoads();
+    m_threadPool.stop();
+
+    // Nothing uses the chunks any more: the jobs that finished may have completed a chunk's
+    // generation, and the rest were dropped. So the edits that were waiting on jobs go in
+    // before the save. Edits in chunks that never finished generating are lost.
+    finishJobs();
+    for (auto& [key, entry] : m_chunks) {
+        entry.m_jobs = 0;
+    }
+    applyEdits();
+    for (auto& [key, entry] : m_chunks) {
+        saveChunk(key, entry);
+    }
+    m_io.flush();
+    for (auto& [key, entry] : m_chunks) {
+        m_chunkPool.release(entry.m_chunk);
+    }
+}
+
+void World::update(const glm::vec3& cameraPosition) {
+    m_cameraPosition = cameraPosition;
+    m_cameraChunkX = static_cast<int>(std::floor(cameraPosition.x / CHUNK_LENGTH));
+    m_cameraChunkZ = static_cast<int>(std::floor(cameraPosition.z / CHUNK_WIDTH));
+
+    finishJobs();
+    applyEdits();
+    remeshDirtyChunks();
+    uploadMeshes();
+    autosave();
+
+    // Unload the chunks the camera has moved away from. They are kept for one ring past the
+    // load distance so that moving back and forth over a chunk border doesn't reload them.
+    int unloadDistance = m_loadDistance + 1;
+    for (auto it = m_chunks.begin(); it != m_chunks.end();) {
+        bool far = distanceSquared(keyX(it->first), keyZ(it->first)) > unloadDistance * unloadDistance;
+        if (far && it->second.m_jobs == 0) {
+            it = unloadChunk(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Queue the missing chunks, the next generation stage of the chunks whose neighbors are
+    // ready for it, and the chunks that are ready to be meshed, closest to the camera first.
+    // Chunks inside the render distance are meshed once their neighbors are generated.
+    int maxJobs = MAX_JOBS_PER_THREAD * static_cast<int>(m_threadPool.getThreadCount());
+    for (const auto& [offsetX, offsetZ] : m_loadOrder) {
+        if (m_jobsInFlight >= maxJobs) {
+            break;
+        }
+        int x = m_cameraChunkX + offsetX, z = m_cameraChunkZ + offsetZ;
+        Entry* entry = find(x, z);
+        if (entry == nullptr) {
+            if (!loadChunk(x, z)) {
+                break; // the memory budget is full of closer chunks
+            }
+        } else if (!entry->m_generated) {
+            generateStage(x, z, *entry);
+        } else if (offsetX * offsetX + offsetZ * offsetZ <= m_renderDistance * m_renderDistance) {
+            meshChunk(x, z, *entry);
+        }
+    }
+}
+
+void World::finishJobs() {
+    m_results.popAll(m_finishedJobs);
+    for (JobResult& result : m_finishedJobs) {
+        --m_jobsInFlight;
+        Entry& entry = m_chunks.at(result.m_key);
+        int x = keyX(result.m_key), z = keyZ(result.m_key);
+        if (result.m_type == JobResult::LOADED || result.m_type == JobResult::GENERATED) {
+            entry.m_stages = result.m_stages;
+            entry.m_generating = false;
+            entry.m_generated = entry.m_stages == TerrainGenerator::STAGE_COUNT;
+            --entry.m_jobs;
+            if (result.m_type == JobResult::GENERATED && result.m_stages > 1) {
+                // every stage after the first pinned the chunks around it
+                for (int dx = -1; dx <= 1; ++dx) {
+                    for (int dz = -1; dz <= 1; ++dz) {
+                        if (dx != 0 || dz != 0) {
+                            --find(x + dx, z + dz)->m_jobs;
+                        }
+                    }
+                }
+            }
+            updateMemoryUsage(entry); // the block storage has grown to fit the terrain
+            continue;
+        }
+
+        // the job no longer needs the neighbors, but the chunk itself stays in use until its mesh is uploaded
+        for (const auto& offset : NEIGHBOR_OFFSETS) {
+            --find(x + offset[0], z + offset[1])->m_jobs;
+        }
+        m_pendingUploads.push_back(std::move(result));
+    }
+    m_finishedJobs.clear();
+}
+
+void World::uploadMeshes() {
+    // upload the meshes closest to the camera first
+    std::sort(m_pendingUploads.begin(), m_pendingUploads.end(), [this](const JobResult& a, const JobResult& b) {
+        return distanceSquared(keyX(a.m_key), keyZ(a.m_key)) < distanceSquared(keyX(b.m_key), keyZ(b.m_key));
+    });
+
+    // always upload at least one mesh so that a mesh larger than the budget can't get stuck
+    auto start = std::chrono::steady_clock::now();
+    m_bytesUploaded = 0;
+    std::size_t uploads = 0;
+    for (; uploads < m_pendingUploads.size(); ++uploads) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (uploads > 0 && (m_bytesUploaded >= UPLOAD_BYTES_PER_FRAME || elapsed.count() >= UPLOAD_SECONDS_PER_FRAME)) {
+            break;
+        }
+        JobResult& upload = m_pendingUploads[uploads];
+        Entry& entry = m_chunks.at(upload.m_key);
+        entry.m_chunk->setMesh(upload.m_meshData);
+        updateMemoryUsage(entry);
+        entry.m_meshing = false;
+        --entry.m_jobs;
+        for (const std::vector<unsigned int>& vertexData : upload.m_meshData.m_vertexData) {
+            m_bytesUploaded += vertexData.size() * sizeof(unsigned int);
+        }
+    }
+    m_pendingUploads.erase(m_pendingUploads.begin(), m_pendingUploads.begin() + uploads);
+}
+
+void World::render(const Frustum& frustum) {
+    // the chunks queue the sections they draw, and the arena draws all of them at the end
+    findVisibleSections(frustum);
+    m_chunksDrawn = m_chunksCulled = m_sectionsDrawn = 0;
+    for (std::size_t i = 0; i < m_visibilityGrid.size(); ++i) {
+        Entry* entry = m_visibilityGrid[i];
+        if (entry == nullptr || !entry->m_chunk->hasMesh()) {
+            continue;
+        }
+        int sectionsDrawn = 0;
+        if (m_reachedSections[i] != 0 && entry->m_chunk->isVisible(frustum)) {
+            sectionsDrawn = entry->m_chunk->render(m_cameraPosition, m_reachedSections[i]);
+        }
+        m_sectionsDrawn += sectionsDrawn;
+        if (sectionsDrawn > 0) {
+            ++m_chunksDrawn;
+        } else {
+            ++m_chunksCulled;
+        }
+    }
+    m_arena.render(m_shader);
+}
+
+void World::findVisibleSections(const Frustum& frustum) {
+    // Walk out from the camera's section to the sections next to it, only through the sides
+    // that the section was entered by can see (see Chunk::isConnected), and never back towards
+    // the camera along an axis already stepped along. Sections outside the frustum are not
+    // entered. Chunks that aren't loaded or meshed yet are open from every side.
+    const int size = 2 * m_renderDistance + 1;
+    m_visibilityGrid.assign(static_cast<std::size_t>(size) * size, nullptr);
+    m_reachedSections.assign(m_visibilityGrid.size(), 0);
+    for (auto& [key, entry] : m_chunks) {
+        int x = keyX(key) - m_cameraChunkX + m_renderDistance, z = keyZ(key) - m_cameraChunkZ + m_renderDistance;
+        if (x >= 0 && z >= 0 && x < size && z < size && distanceSquared(keyX(key), keyZ(key)) <= m_renderDistance * m_renderDistance) {
+            m_visibilityGrid[x * size + z] = &entry;
+        }
+    }
+    if (!m_occlusionCulling) {
+        std::fill(m_reachedSections.begin(), m_reachedSections.end(), ALL_SECTIONS);
+        return;
+    }
+
+    // from above or below the world, the search starts in the top or bottom section
+    int cameraSection = static_cast<int>(std::floor(m_cameraPosition.y / SECTION_HEIGHT));
+    cameraSection = std::min(std::max(cameraSection, 0), SECTIONS_PER_CHUNK - 1);
+    m_searchQueue.clear();
+    m_searchQueue.push_back({ m_renderDistance, m_renderDistance, cameraSection, SectionStep::NO_SIDE, 0 });
+    m_reachedSections[m_renderDistance * size + m_renderDistance] = 1u << cameraSection;
+    for (std::size_t i = 0; i < m_searchQueue.size(); ++i) {
+        const SectionStep step = m_searchQueue[i];
+        const Entry* entry = m_visibilityGrid[step.m_x * size + step.m_z];
+        for (unsigned int side = 0; side < Block::FACES_PER_BLOCK; ++side) {
+            if ((step.m_directions >> (side ^ 1)) & 1) {
+                continue;
+            }
+            if (step.m_from != SectionStep::NO_SIDE && entry != nullptr
+                && !entry->m_chunk->isConnected(step.m_section, static_cast<Block::BlockFace>(step.m_from), static_cast<Block::BlockFace>(side))) {
+                continue;
+            }
+            int x = step.m_x + SIDE_OFFSETS[side][0], section = step.m_section + SIDE_OFFSETS[side][1], z = step.m_z + SIDE_OFFSETS[side][2];
+            int offsetX = x - m_renderDistance, offsetZ = z - m_renderDistance;
+            if (section < 0 || section >= SECTIONS_PER_CHUNK || offsetX * offsetX + offsetZ * offsetZ > m_renderDistance * m_renderDistance) {
+                continue;
+            }
+            unsigned int& reached = m_reachedSections[x * size + z];
+            if ((reached >> section) & 1) {
+                continue;
+            }
+            glm::vec3 boxMin((m_cameraChunkX + offsetX) * CHUNK_LENGTH, section * SECTION_HEIGHT, (m_cameraChunkZ + offsetZ) * CHUNK_WIDTH);
+            if (!frustum.intersects(boxMin, boxMin + glm::vec3(CHUNK_LENGTH, SECTION_HEIGHT, CHUNK_WIDTH))) {
+                continue;
+            }
+            reached |= 1u << section;
+            m_searchQueue.push_back({ x, z, section, static_cast<unsigned char>(side ^ 1), static_cast<unsigned char>(step.m_directions | 1u << side) });
+        }
+    }
+}
+
+void World::printMeshStats() const {
+    for (const auto& [key, entry] : m_chunks) {
+        if (entry.m_chunk->hasMesh()) {
+            entry.m_chunk->printMeshStats();
+        }
+    }
+    m_chunkPool.printStats("Chunks");
+    Chunk::printPoolStats();
+    m_arena.printStats();
+    std::cout << "Terrain noise batches use " << BatchNoise::getInstructionSet() << '\n';
+}
+
+int World::getChunksDrawn() const {
+    return m_chunksDrawn;
+}
+
+int World::getChunksCulled() const {
+    return m_chunksCulled;
+}
+
+int World::getSectionsDrawn() const {
+    return m_sectionsDrawn;
+}
+
+void World::setOcclusionCulling(bool enabled) {
+    m_occlusionCulling = enabled;
+}
+
+bool World::getOcclusionCulling() const {
+    return m_occlusionCulling;
+}
+
+std::size_t World::getChunkCount() const {
+    return m_chunks.size();
+}
+
+std::size_t World::getMemoryUsage() const {
+    return m_memoryUsage;
+}
+
+std::size_t World::getUploadQueueDepth() const {
+    return m_pendingUploads.size();
+}
+
+std::size_t World::getBytesUploaded() const {
+    return m_bytesUploaded;
+}
+
+int World::getSectionsRemeshed() const {
+    return m_sectionsRemeshed;
+}
+
+std::size_t World::getQueuedSaves() const {
+    return m_io.getQueuedSaves();
+}
+
+World::Entry* World::find(int x, int z) {
+    auto it = m_chunks.find(chunkKey(x, z));
+    return it == m_chunks.end() ? nullptr : &it->second;
+}
+
+void World::put(int x, int y, int z, Block::BlockType block) {
+    // applied at the start of the next update, so every edit made in a frame is remeshed together
+    m_pendingEdits.push_back(Edit{ x, y, z, block });
+}
+
+void World::applyEdits() {
+    // An edit has to wait while a job is using its chunk (jobs also pin the neighbors they
+    // read), and until the chunk has finished generating, or a later stage could overwrite it.
+    // Edits outside the world or in chunks that aren't loaded are dropped, and so are the
+    // edits still waiting for a chunk to generate when the world is destroyed.
+    std::size_t waiting = 0;
+    for (const Edit& edit : m_pendingEdits) {
+        Entry* entry = find(floorDiv(edit.m_x, CHUNK_LENGTH), floorDiv(edit.m_z, CHUNK_WIDTH));
+        if (entry == nullptr || edit.m_y < 0 || edit.m_y >= CHUNK_HEIGHT) {
+            continue;
+        }
+        if (entry->m_jobs > 0 || !entry->m_generated) {
+            m_pendingEdits[waiting++] = edit;
+            continue;
+        }
+        int x = edit.m_x - floorDiv(edit.m_x, CHUNK_LENGTH) * CHUNK_LENGTH;
+        int z = edit.m_z - floorDiv(edit.m_z, CHUNK_WIDTH) * CHUNK_WIDTH;
+        entry->m_chunk->put(x, edit.m_y, z, edit.m_block);
+        updateMemoryUsage(*entry);
+    }
+    m_pendingEdits.resize(waiting);
+}
+
+void World::remeshDirtyChunks() {
+    // Rebuild only the dirty sections, right here on the main thread: a section is small
+    // enough that this is quicker than a round trip through the thread pool. Chunks without
+    // a mesh yet get their dirty sections in the full mesh built by meshChunk.
+    for (auto& [key, entry] : m_chunks) {
+        unsigned int dirtySections = entry.m_chunk->getDirtySections();
+        if (dirtySections == 0 || entry.m_jobs > 0 || !entry.m_chunk->hasMesh()) {
+            continue;
+        }
+        // the mesher reads the neighbors' borders, so they can't be generating
+        bool neighborsReady = true;
+        for (const auto& offset : NEIGHBOR_OFFSETS) {
+            Entry* neighbor = find(keyX(key) + offset[0], keyZ(key) + offset[1]);
+            if (neighbor != nullptr && !neighbor->m_generated) {
+                neighborsReady = false;
+            }
+        }
+        if (!neighborsReady) {
+            continue;
+        }
+        entry.m_chunk->updateMesh(Chunk::MeshMode::GREEDY, dirtySections);
+        updateMemoryUsage(entry);
+        for (; dirtySections != 0; dirtySections &= dirtySections - 1) {
+            ++m_sectionsRemeshed;
+        }
+    }
+}
+
+void World::updateMemoryUsage(Entry& entry) {
+    // only called on the main thread while no job is writing to the chunk
+    m_memoryUsage -= entry.m_memoryUsage;
+    entry.m_memoryUsage = entry.m_chunk->getMemoryUsage();
+    m_memoryUsage += entry.m_memoryUsage;
+}
+
+bool World::loadChunk(int x, int z) {
+    // Make room in the memory budget by evicting chunks that are further away than this one.
+    // A new chunk is expected to use as much memory as the average loaded chunk (with its mesh).
+    std::size_t expectedUsage = m_chunks.empty() ? 0 : m_memoryUsage / m_chunks.size();
+    while (m_memoryUsage + expectedUsage > m_memoryBudget) {
+        if (!evictFarthest(distanceSquared(x, z))) {
+            return false;
+        }
+    }
+
+    Chunk* chunk = m_chunkPool.acquire(static_cast<float>(x), static_cast<float>(z), &m_arena);
+    for (int direction = 0; direction < 4; ++direction) {
+        Entry* neighbor = find(x + NEIGHBOR_OFFSETS[direction][0], z + NEIGHBOR_OFFSETS[direction][1]);
+        if (neighbor != nullptr) {
+            chunk->addNeighbor(neighbor->m_chunk, static_cast<Chunk::Direction>(direction));
+            neighbor->m_chunk->addNeighbor(chunk, OPPOSITE[direction]);
+        }
+    }
+    long long key = chunkKey(x, z);
+    Entry& entry = m_chunks.emplace(key, Entry{ chunk, 1, 0, true, false, false, 0 }).first->second;
+    updateMemoryUsage(entry);
+
+    // load the terrain on the I/O thread. if it was never saved, update generates it a stage at a time
+    ++m_jobsInFlight;
+    m_io.load(x, z, chunk, [this, chunk, key](bool loaded) {
+        if (!loaded) {
+            m_results.push(JobResult{ JobResult::LOADED, key, 0, {} });
+            return;
+        }
+        // The stages of the chunks around it read its ground heights, which aren't saved. Finding
+        // them samples the terrain noise, so it runs on a worker instead of holding up the loads
+        // and saves queued behind this one on the I/O thread.
+        m_threadPool.submit([this, chunk, key]() {
+            chunk->generateTerrainHeights(m_terrain);
+            m_results.push(JobResult{ JobResult::LOADED, key, TerrainGenerator::STAGE_COUNT, {} });
+        });
+    });
+    return true;
+}
+
+bool World::generateStage(int x, int z, Entry& entry) {
+    if (entry.m_generating) {
+        return false;
+    }
+    // After the first stage, every chunk around this one must have finished the stage before,
+    // and must stay loaded until the job is done. The stages only read what the earlier stages
+    // of the chunks around them left behind, so neighbors can run the same stage at once.
+    const Chunk* area[3][3] = {};
+    if (entry.m_stages > 0) {
+        Entry* neighbors[8];
+        int count = 0;
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dz = -1; dz <= 1; ++dz) {
+                if (dx == 0 && dz == 0) {
+                    continue;
+                }
+                Entry* neighbor = find(x + dx, z + dz);
+                if (neighbor == nullptr || neighbor->m_stages < entry.m_stages) {
+                    return false;
+                }
+                area[1 + dx][1 + dz] = neighbor->m_chunk;
+                neighbors[count++] = neighbor;
+            }
+        }
+        for (Entry* neighbor : neighbors) {
+            ++neighbor->m_jobs;
+        }
+    }
+    area[1][1] = entry.m_chunk;
+    ++entry.m_jobs;
+    entry.m_generating = true;
+
+    ++m_jobsInFlight;
+    Chunk* chunk = entry.m_chunk;
+    long long key = chunkKey(x, z);
+    int stage = entry.m_stages;
+    m_threadPool.submit([this, chunk, key, stage, area]() {
+        chunk->generateStage(m_terrain, stage, area);
+        m_results.push(JobResult{ JobResult::GENERATED, key, stage + 1, {} });
+    });
+    return true;
+}
+
+bool World::meshChunk(int x, int z, Entry& entry) {
+    if (!entry.m_generated || entry.m_meshing || entry.m_chunk->hasMesh()) {
+        return false;
+    }
+    // The mesh job reads the border blocks of all four neighbors, so they must be generated and
+    // must stay loaded until it is done. Their neighbor pointers to this chunk can't change then.
+    Entry* neighbors[4];
+    for (int direction = 0; direction < 4; ++direction) {
+        neighbors[direction] = find(x + NEIGHBOR_OFFSETS[direction][0], z + NEIGHBOR_OFFSETS[direction][1]);
+        if (neighbors[direction] == nullptr || !neighbors[direction]->m_generated) {
+            return false;
+        }
+    }
+    for (Entry* neighbor : neighbors) {
+        ++neighbor->m_jobs;
+    }
+    ++entry.m_jobs;
+    entry.m_meshing = true;
+    entry.m_chunk->clearDirtySections(); // the whole chunk is meshed, and it can't be edited until the mesh is uploaded
+
+    ++m_jobsInFlight;
+    const Chunk* chunk = entry.m_chunk;
+    long long key = chunkKey(x, z);
+    m_threadPool.submit([this, chunk, key]() {
+        m_results.push(JobResult{ JobResult::MESHED, key, 0, chunk->buildMesh(Chunk::MeshMode::GREEDY) });
+    });
+    return true;
+}
+
+std::unordered_map<long long, World::Entry>::iterator World::unloadChunk(std::unordered_map<long long, Entry>::iterator it) {
+    int x = keyX(it->first), z = keyZ(it->first);
+    Chunk* chunk = it->second.m_chunk;
+    for (int direction = 0; direction < 4; ++direction) {
+        Entry* neighbor = find(x + NEIGHBOR_OFFSETS[direction][0], z + NEIGHBOR_OFFSETS[direction][1]);
+        if (neighbor != nullptr) {
+            neighbor->m_chunk->addNeighbor(nullptr, OPPOSITE[direction]);
+        }
+    }
+    saveChunk(it->first, it->second);
+    m_memoryUsage -= it->second.m_memoryUsage;
+    m_chunkPool.release(chunk);
+    return m_chunks.erase(it);
+}
+
+void World::autosave() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_lastAutosave < AUTOSAVE_INTERVAL) {
+        return;
+    }
+    m_lastAutosave = now;
+    for (const auto& [key, entry] : m_chunks) {
+        saveChunk(key, entry);
+    }
+}
+
+void World::saveChunk(long long key, const Entry& entry) {
+    // Only chunks that finished generating and have changed since they were loaded. The
+    // chunk is copied into the save queue, and written later on the I/O thread.
+    if (entry.m_generated && !entry.m_chunk->isSaved()) {
+        m_io.save(keyX(key), keyZ(key), *entry.m_chunk);
+        entry.m_chunk->markSaved();
+    }
+}
+
+bool World::evictFarthest(int minDistance) {
+    // only chunks further away than minDistance (squared) and not in use by a job may be evicted
+    auto farthest = m_chunks.end();
+    int farthestDistance = minDistance;
+    for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it) {
+        int distance = distanceSquared(keyX(it->first), keyZ(it->first));
+        if (distance > farthestDistance && it->second.m_jobs == 0) {
+            farthest = it;
+            farthestDistance = distance;
+        }
+    }
+    if (farthest == m_chunks.end()) {
+        return false;
+    }
+    unloadChunk(farthest);
+    return true;
+}
+
+int World::distanceSquared(int x, int z) const {
+    int dx = x - m_cameraChunkX, dz = z - m_cameraChunkZ;
+    return dx * dx + dz * dz;
+}
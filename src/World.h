@@ -0,0 +1,139 @@
+#ifndef WORLD_H_INCLUDED
+#define WORLD_H_INCLUDED
+
+#include "Chunk.h"
+#include "BlockInfo.h"
+#include "ShaderProgram.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+#include "LockFreeQueue.h"
+#include "ObjectPool.h"
+#include "VertexArena.h"
+#include "ChunkIO.h"
+#include "TerrainGenerator.h"
+
+#include <glm/glm.hpp>
+
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <string>
+#include <chrono>
+
+class World {
+
+    // A loaded chunk and the background jobs that use it. Only the main thread touches these.
+    struct Entry {
+        Chunk* m_chunk;
+        int m_jobs;        // running jobs that read or write the chunk's blocks (it can't be unloaded until they finish)
+        int m_stages;      // the terrain generation stages finished (all of them for a chunk loaded from disk)
+        bool m_generating; // a job is loading the chunk or running its next stage
+        bool m_generated;  // every stage has finished
+        bool m_meshing;    // a job is building the chunk's mesh
+        std::size_t m_memoryUsage; // the chunk's share of World::m_memoryUsage
+    };
+
+    // sent back to the main thread by a job when it finishes
+    struct JobResult {
+        enum Type : unsigned char {
+            LOADED, GENERATED, MESHED
+        };
+        Type m_type;
+        long long m_key;
+        int m_stages; // the stages the chunk has finished, for LOADED and GENERATED
+        Chunk::MeshData m_meshData;
+    };
+
+    // a section reached by the visibility search, through its side m_from (NO_SIDE for the
+    // camera's section). m_x and m_z index the visibility grid
+    struct SectionStep {
+        static constexpr unsigned char NO_SIDE = Block::FACES_PER_BLOCK;
+        int m_x, m_z, m_section;
+        unsigned char m_from;
+        unsigned char m_directions; // a bit for each Block::BlockFace the search has stepped towards to get here
+    };
+
+    // a block change waiting to be applied, in world block coordinates
+    struct Edit {
+        int m_x, m_y, m_z;
+        Block::BlockType m_block;
+    };
+
+    VertexArena m_arena;                              // the meshes of every chunk, drawn in one call (declared first so it outlives the chunks)
+    ObjectPool<Chunk> m_chunkPool;                    // unloaded chunks are recycled for the next ones loaded
+    std::unordered_map<long long, Entry> m_chunks;    // keyed by the chunk's (x, z) position
+    std::vector<std::pair<int, int>> m_loadOrder;     // chunk offsets around the camera, nearest first
+    ShaderProgram* m_shader;
+    const int m_renderDistance;                       // in chunks
+    const int m_loadDistance;                         // in chunks, far enough out for every drawn chunk to finish generating
+    const std::size_t m_memoryBudget;                 // in bytes
+    std::size_t m_memoryUsage;
+    glm::vec3 m_cameraPosition;
+    int m_cameraChunkX, m_cameraChunkZ;
+    int m_chunksDrawn, m_chunksCulled, m_sectionsDrawn;
+    bool m_occlusionCulling;
+    // the chunks within the render distance around the camera's chunk, in rows of x, and the
+    // sections of each that the visibility search reached. rebuilt every frame
+    std::vector<Entry*> m_visibilityGrid;
+    std::vector<unsigned int> m_reachedSections;
+    std::vector<SectionStep> m_searchQueue;
+    int m_jobsInFlight;
+    LockFreeQueue<JobResult> m_results;
+    std::vector<JobResult> m_finishedJobs;
+    std::vector<JobResult> m_pendingUploads;          // meshes waiting to be uploaded to the GPU
+    std::size_t m_bytesUploaded;                      // in the last frame
+    std::vector<Edit> m_pendingEdits;
+    int m_sectionsRemeshed;                           // since the world was created
+    std::chrono::steady_clock::time_point m_lastAutosave;
+    const TerrainGenerator m_terrain;                 // shared by every generation job
+    ChunkIO m_io;                                     // chunks are saved when they are unloaded, and loaded instead of generated
+    ThreadPool m_threadPool;
+
+public:
+    // the texture slot the shader's u_pageOffsets reads the arena's chunk positions from
+    static constexpr unsigned int PAGE_OFFSETS_SLOT = 1;
+
+    // the world keeps its own copy of terrain
+    World(ShaderProgram* shader, int renderDistance, std::size_t memoryBudget, const std::string& saveDirectory, const TerrainGenerator& terrain);
+    ~World();
+
+    void update(const glm::vec3& cameraPosition);
+    // the block changes in the next update that its chunk is generated and not in use by a job.
+    // the world applies what it can when it is destroyed, and edits to ungenerated chunks are lost
+    void put(int x, int y, int z, Block::BlockType block);
+    void render(const Frustum& frustum);
+    void printMeshStats() const;
+    int getChunksDrawn() const;
+    int getChunksCulled() const;
+    int getSectionsDrawn() const;
+    // with occlusion culling, only the sections that can be seen from the camera's section
+    // through the transparent blocks between them are drawn. on by default
+    void setOcclusionCulling(bool enabled);
+    bool getOcclusionCulling() const;
+    std::size_t getChunkCount() const;
+    std::size_t getMemoryUsage() const;
+    std::size_t getUploadQueueDepth() const;
+    std::size_t getBytesUploaded() const;
+    int getSectionsRemeshed() const;
+    std::size_t getQueuedSaves() const;
+
+private:
+    Entry* find(int x, int z);
+    void finishJobs();
+    void uploadMeshes();
+    void applyEdits();
+    void remeshDirtyChunks();
+    void findVisibleSections(const Frustum& frustum);
+    void updateMemoryUsage(Entry& entry);
+    bool loadChunk(int x, int z);
+    bool generateStage(int x, int z, Entry& entry);
+    bool meshChunk(int x, int z, Entry& entry);
+    std::unordered_map<long long, Entry>::iterator unloadChunk(std::unordered_map<long long, Entry>::iterator it);
+    bool evictFarthest(int minDistance);
+    void autosave();
+    void saveChunk(long long key, const Entry& entry);
+    int distanceSquared(int x, int z) const;
+};
+
+#endif